@@ -0,0 +1,35 @@
+#pragma once
+
+// stlib
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Small helpers shared by the headless benchmarks. Each benchmark builds a fixed scene from a
+// fixed seed and prints the average cost of the operation it measures, so runs on different
+// machines or thread counts can be compared line by line.
+
+using BenchClock = std::chrono::high_resolution_clock;
+
+// Average time of one call of fn in ms, over runs calls after one warm up call
+template <typename Fn>
+double averageMs(int runs, Fn fn)
+{
+	fn();
+	auto start = BenchClock::now();
+	for (int r = 0; r < runs; r++)
+		fn();
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count() / runs;
+}
+
+// Thread count from the first command line argument, fallback when there is none
+inline unsigned int threadArgument(int argc, char* argv[], unsigned int fallback)
+{
+	if (argc < 2) return fallback;
+	int threads = std::atoi(argv[1]);
+	if (threads < 1 || threads > 64) {
+		fprintf(stderr, "usage: %s [threads 1-64]\n", argv[0]);
+		std::exit(1);
+	}
+	return (unsigned int)threads;
+}
@@ -0,0 +1,85 @@
+// internal
+#include "bench.hpp"
+#include "ai_system.hpp"
+#include "flow_field.hpp"
+#include "game_level.hpp"
+#include "rng.hpp"
+#include "spatial_grid.hpp"
+#include "job_system.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <random>
+
+// AI step with 2000 enemies and 1000 player projectiles in the fire boss room, every
+// enemy near enough to the player to decide each step, so every step runs the full decision
+// budget. Usage: bench_ai [threads]
+//
+// Firing creates projectiles through the renderer's meshes, which need a GL context, so the
+// enemies start out of mana and never fire. The decide phase that is split across threads
+// runs in full, only the serial creation of their shots is left out.
+const uint NUM_ENEMIES = 2000;
+const uint NUM_PROJECTILES = 1000;
+const int RUNS = 200;
+
+int main(int argc, char* argv[])
+{
+	uint threads = threadArgument(argc, argv, 1);
+	jobs.start(threads);
+
+	rng.seed(1);
+	GameLevel room;
+	room.init(FIRE_BOSS);
+	flow_field.bake(room.getTerrains());
+	vec4 floor = room.getFloorAttrs()[0];
+
+	SpriteSheet sheet;
+	sheet.states.assign((int)ENEMY_STATES::STATE_COUNT, { 0, 0 });
+
+	Entity player = Entity();
+	registry.players.emplace(player);
+	vec2 center = vec2(floor.x + floor.z / 2.f, floor.y + floor.w / 2.f);
+	Position& player_position = registry.positions.emplace(player);
+	player_position.position = center;
+	player_position.scale = { 40.f, 60.f };
+	registry.collidables.emplace(player);
+
+	// everyone within 500 px of the player, so the level of detail lets them all decide every step
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+	std::uniform_real_distribution<float> radius(20.f, 480.f);
+	std::uniform_real_distribution<float> health(0.f, 100.f);
+	for (uint i = 0; i < NUM_ENEMIES; i++) {
+		Entity entity = Entity();
+		float a = angle(gen);
+		Position& position = registry.positions.emplace(entity);
+		position.position = center + radius(gen) * vec2(cos(a), sin(a));
+		position.prev_position = position.position;
+		position.scale = { 50.f, 50.f };
+		registry.velocities.emplace(entity).velocity = { 50.f, 0.f };
+		registry.resources.emplace(entity).currentHealth = health(gen);
+		Enemy& enemy = registry.enemies.emplace(entity);
+		enemy.type = (ElementType)(i % 4);
+		enemy.mana = -1000.f;
+		registry.animations.emplace(entity).sprite_sheet_ptr = &sheet;
+		registry.collidables.emplace(entity);
+	}
+	std::uniform_real_distribution<float> x(floor.x, floor.x + floor.z), y(floor.y, floor.y + floor.w);
+	for (uint i = 0; i < NUM_PROJECTILES; i++) {
+		Entity entity = Entity();
+		registry.projectiles.emplace(entity).hostile = false;
+		Position& position = registry.positions.emplace(entity);
+		position.position = { x(gen), y(gen) };
+		position.scale = { 20.f, 20.f };
+		float a = angle(gen);
+		registry.velocities.emplace(entity).velocity = 700.f * vec2(cos(a), sin(a));
+		registry.collidables.emplace(entity);
+	}
+	spatial_grid.build();
+
+	AISystem ai;
+	ai.init(nullptr);
+	double step_ms = averageMs(RUNS, [&]() { ai.step(1000.f / 120.f); });
+	printf("%u enemies, %u threads: %.3f ms per AI step, %u decisions per step\n", NUM_ENEMIES, jobs.thread_count(), step_ms, perf_stats.ai_updated);
+	return 0;
+}
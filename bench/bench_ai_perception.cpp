@@ -0,0 +1,108 @@
+// internal
+#include "bench.hpp"
+#include "ai_perception.hpp"
+#include "danger_map.hpp"
+#include "flow_field.hpp"
+#include "spatial_grid.hpp"
+#include "game_level.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <random>
+
+// What 2000 enemies perceive among each other and 5000 projectiles spread over 8000x8000 px,
+// through the perception snapshot and by scanning every other enemy and every projectile for
+// each enemy the way the AI did before. Usage: bench_ai_perception
+const uint NUM_ENEMIES = 2000;
+const uint NUM_PROJECTILES = 5000;
+const float SCENE_SIZE = 8000.f;
+const float WALL = 25.f;
+const float DANGER_CELL_SIZE = 32.f;
+const float SEE_PROJECTILE_RANGE = 300.f;
+const int RUNS = 20;
+
+int main()
+{
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<float> coordinate(WALL, SCENE_SIZE - WALL);
+	std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+
+	Entity player = Entity();
+	registry.players.emplace(player);
+	Position& player_position = registry.positions.emplace(player);
+	player_position.position = vec2(SCENE_SIZE / 2.f);
+	player_position.scale = { 40.f, 60.f };
+	registry.collidables.emplace(player);
+
+	for (uint i = 0; i < NUM_ENEMIES; i++) {
+		Entity entity = Entity();
+		registry.enemies.emplace(entity).type = (ElementType)(i % 4);
+		registry.resources.emplace(entity).currentHealth = (float)(i % 100);
+		Position& position = registry.positions.emplace(entity);
+		position.position = { coordinate(gen), coordinate(gen) };
+		position.scale = { 50.f, 50.f };
+		registry.velocities.emplace(entity);
+		registry.collidables.emplace(entity);
+	}
+	for (uint i = 0; i < NUM_PROJECTILES; i++) {
+		Entity entity = Entity();
+		registry.projectiles.emplace(entity).hostile = (i % 2 == 1);
+		Position& position = registry.positions.emplace(entity);
+		position.position = { coordinate(gen), coordinate(gen) };
+		position.scale = { 20.f, 20.f };
+		float a = angle(gen);
+		registry.velocities.emplace(entity).velocity = 700.f * vec2(cos(a), sin(a));
+		registry.collidables.emplace(entity);
+	}
+
+	std::vector<std::pair<vec4, Terrain>> walls = {
+		{ vec4(0.f, 0.f, SCENE_SIZE, WALL), NORTH_STATIONARY },
+		{ vec4(0.f, SCENE_SIZE - WALL, SCENE_SIZE, WALL), SOUTH_STATIONARY },
+		{ vec4(0.f, 0.f, WALL, SCENE_SIZE), SIDE_STATIONARY },
+		{ vec4(SCENE_SIZE - WALL, 0.f, WALL, SCENE_SIZE), SIDE_STATIONARY },
+	};
+	flow_field.bake(walls);
+	flow_field.update(vec2(SCENE_SIZE / 2.f));
+	spatial_grid.build();
+
+	// the grid is built by the physics step anyway, so it is not counted
+	AIPerception perception;
+	uint neighbours = 0;
+	double perception_ms = averageMs(RUNS, [&]() {
+		danger_map.build(DANGER_CELL_SIZE);
+		perception.begin(spatial_grid, danger_map, flow_field);
+		neighbours = 0;
+		for (uint i = 0; i < perception.size(); i++) {
+			perception.perceive(i, 0);
+			neighbours += perception.enemy(i).neighbour_count;
+		}
+	});
+
+	uint scanned_neighbours = 0, seeing = 0;
+	double scan_ms = averageMs(RUNS / 4, [&]() {
+		scanned_neighbours = 0;
+		seeing = 0;
+		for (uint i = 0; i < registry.enemies.size(); i++) {
+			Entity entity = registry.enemies.entities[i];
+			vec2 position = registry.positions.get(entity).position;
+			bool sees_projectile = false;
+			for (uint j = 0; j < registry.projectiles.size(); j++) {
+				Entity projectile = registry.projectiles.entities[j];
+				if (registry.projectiles.components[j].hostile) continue;
+				if (distance(registry.positions.get(projectile).position, position) < SEE_PROJECTILE_RANGE) sees_projectile = true;
+			}
+			seeing += sees_projectile;
+			for (uint j = 0; j < registry.enemies.size(); j++) {
+				if (j == i) continue;
+				Entity other = registry.enemies.entities[j];
+				if (distance(registry.positions.get(other).position, position) < AIPerception::NEIGHBOUR_RANGE)
+					scanned_neighbours++;
+			}
+		}
+	});
+
+	printf("%u enemies, %u projectiles over %gx%g px\n", NUM_ENEMIES, NUM_PROJECTILES, SCENE_SIZE, SCENE_SIZE);
+	printf("perception (danger map, snapshot, every enemy perceived): %.3f ms, %u neighbours\n", perception_ms, neighbours);
+	printf("scanning every enemy and projectile per enemy: %.3f ms, %u neighbours, %u enemies see a projectile\n", scan_ms, scanned_neighbours, seeing);
+	return neighbours == scanned_neighbours ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// internal
+#include "bench.hpp"
+#include "flow_field.hpp"
+#include "game_level.hpp"
+#include "rng.hpp"
+
+// stlib
+#include <random>
+
+// Flow field bake, update toward a moving target and lookups by 2000 enemies, in the fire boss
+// room as the level has it, the same room with 40 pillars and a 10000x10000 px arena with 500
+// pillars. Usage: bench_flow_field
+const uint NUM_LOOKUPS = 2000;
+const int RUNS = 20;
+const float WALL = 25.f;
+
+// keeps the lookups from being optimised away
+volatile float lookup_sink;
+
+// Pillars of 25x200 px scattered over the floor
+void addPillars(std::vector<std::pair<vec4, Terrain>>& terrains, vec4 floor, uint count, std::mt19937& gen)
+{
+	std::uniform_real_distribution<float> x(floor.x + 75.f, floor.x + floor.z - 100.f);
+	std::uniform_real_distribution<float> y(floor.y + 125.f, floor.y + floor.w - 200.f);
+	for (uint i = 0; i < count; i++)
+		terrains.push_back({ vec4(x(gen), y(gen), WALL, 200.f), SIDE_STATIONARY });
+}
+
+void run(const char* name, const std::vector<std::pair<vec4, Terrain>>& terrains, vec4 floor, std::mt19937& gen)
+{
+	double bake_ms = averageMs(RUNS, [&]() { flow_field.bake(terrains); });
+
+	std::uniform_real_distribution<float> x(floor.x, floor.x + floor.z), y(floor.y, floor.y + floor.w);
+	double update_ms = averageMs(RUNS, [&]() { flow_field.update({ x(gen), y(gen) }); });
+
+	std::vector<vec2> enemies(NUM_LOOKUPS);
+	for (vec2& enemy : enemies)
+		enemy = { x(gen), y(gen) };
+	vec2 sum = { 0.f, 0.f };
+	double lookup_ms = averageMs(RUNS * 5, [&]() {
+		for (vec2 enemy : enemies)
+			sum += flow_field.direction(enemy);
+	});
+	lookup_sink = sum.x + sum.y;
+
+	printf("%s, %dx%d cells: bake %.3f ms, update %.3f ms, %u lookups %.4f ms\n", name, flow_field.size().x, flow_field.size().y,
+		bake_ms, update_ms, NUM_LOOKUPS, lookup_ms);
+}
+
+int main()
+{
+	rng.seed(1);
+	std::mt19937 gen(1);
+
+	GameLevel room;
+	room.init(FIRE_BOSS);
+	vec4 room_floor = room.getFloorAttrs()[0];
+	std::vector<std::pair<vec4, Terrain>> terrains = room.getTerrains();
+	run("fire boss room", terrains, room_floor, gen);
+	addPillars(terrains, room_floor, 40, gen);
+	run("fire boss room with 40 pillars", terrains, room_floor, gen);
+
+	vec4 arena_floor = { WALL, WALL, 10000.f, 10000.f };
+	std::vector<std::pair<vec4, Terrain>> arena = {
+		{ vec4(WALL, 0.f, arena_floor.z, WALL), NORTH_STATIONARY },
+		{ vec4(WALL, arena_floor.w + WALL, arena_floor.z, WALL), SOUTH_STATIONARY },
+		{ vec4(0.f, 0.f, WALL, arena_floor.w + 2.f * WALL), SIDE_STATIONARY },
+		{ vec4(arena_floor.z + WALL, 0.f, WALL, arena_floor.w + 2.f * WALL), SIDE_STATIONARY },
+	};
+	addPillars(arena, arena_floor, 500, gen);
+	run("10000x10000 arena with 500 pillars", arena, arena_floor, gen);
+	return 0;
+}
@@ -0,0 +1,100 @@
+// internal
+#include "bench.hpp"
+#include "projectile_pool.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// Firing and removing 50000 projectiles at once, as fresh ECS entities and through the
+// projectile pool, and one pool update over all of them live. The components written are the
+// ones createProjectile writes, it cannot be called itself without the renderer's meshes.
+// Usage: bench_projectile_pool
+const uint NUM_PROJECTILES = 50000;
+const int ROUNDS = 5;
+
+Mesh mesh;
+SpriteSheet sprite_sheet;
+
+void addShotComponents(Entity entity, vec2 position)
+{
+	registry.animations.emplace(entity).sprite_sheet_ptr = &sprite_sheet;
+	registry.velocities.emplace(entity).velocity = { 700.f, 0.f };
+	registry.positions.get(entity).position = position;
+	registry.collidables.emplace(entity);
+	registry.renderRequests.insert(entity,
+		{ TEXTURE_ASSET_ID::WATER_PROJECTILE_SHEET, EFFECT_ASSET_ID::ANIMATED, GEOMETRY_BUFFER_ID::WATER_PROJECTILE });
+}
+
+// A new entity for every shot, as before the pool
+Entity createEntity(vec2 position)
+{
+	Entity entity = Entity();
+	registry.projectiles.emplace(entity);
+	registry.meshPtrs.emplace(entity, &mesh);
+	registry.spriteSheetPtrs.emplace(entity, &sprite_sheet);
+	registry.positions.emplace(entity);
+	addShotComponents(entity, position);
+	return entity;
+}
+
+Entity acquireEntity(vec2 position)
+{
+	Entity entity = projectile_pool.acquire(PROJECTILE_LIFETIME_MS);
+	if (registry.positions.has(entity)) {
+		registry.meshPtrs.get(entity) = &mesh;
+		registry.spriteSheetPtrs.get(entity) = &sprite_sheet;
+		registry.positions.get(entity) = Position();
+	}
+	else {
+		registry.meshPtrs.emplace(entity, &mesh);
+		registry.spriteSheetPtrs.emplace(entity, &sprite_sheet);
+		registry.positions.emplace(entity);
+	}
+	addShotComponents(entity, position);
+	return entity;
+}
+
+int main()
+{
+	std::vector<Entity> shots;
+	shots.reserve(NUM_PROJECTILES);
+
+	// the first round of each fills the containers' capacity, so it is not counted
+	double create_ms = 0.0, remove_ms = 0.0;
+	for (int round = 0; round <= ROUNDS; round++) {
+		auto start = BenchClock::now();
+		for (uint i = 0; i < NUM_PROJECTILES; i++)
+			shots.push_back(createEntity({ (float)i, 0.f }));
+		auto created = BenchClock::now();
+		for (Entity shot : shots)
+			registry.remove_all_components_of(shot);
+		auto removed = BenchClock::now();
+		shots.clear();
+		if (round == 0) continue;
+		create_ms += std::chrono::duration<double, std::milli>(created - start).count() / ROUNDS;
+		remove_ms += std::chrono::duration<double, std::milli>(removed - created).count() / ROUNDS;
+	}
+	printf("%u projectiles as new entities: create %.2f ms, remove_all_components_of %.2f ms\n", NUM_PROJECTILES, create_ms, remove_ms);
+
+	// wide enough that nothing is culled for leaving the level
+	projectile_pool.set_bounds({ { vec4(0.f, 0.f, (float)NUM_PROJECTILES, 100.f), Terrain() } });
+	double acquire_ms = 0.0, update_ms = 0.0, release_ms = 0.0;
+	for (int round = 0; round <= ROUNDS; round++) {
+		auto start = BenchClock::now();
+		for (uint i = 0; i < NUM_PROJECTILES; i++)
+			shots.push_back(acquireEntity({ (float)i, 0.f }));
+		auto acquired = BenchClock::now();
+		projectile_pool.update(1000.f / 120.f);
+		auto updated = BenchClock::now();
+		for (Entity shot : shots)
+			projectile_pool.release(shot);
+		auto released = BenchClock::now();
+		shots.clear();
+		// lets the released slots finish cooling
+		projectile_pool.update(0.f);
+		if (round == 0) continue;
+		acquire_ms += std::chrono::duration<double, std::milli>(acquired - start).count() / ROUNDS;
+		update_ms += std::chrono::duration<double, std::milli>(updated - acquired).count() / ROUNDS;
+		release_ms += std::chrono::duration<double, std::milli>(released - updated).count() / ROUNDS;
+	}
+	printf("%u projectiles through the pool: acquire %.2f ms, update %.2f ms, release %.2f ms\n", NUM_PROJECTILES, acquire_ms, update_ms, release_ms);
+	return 0;
+}
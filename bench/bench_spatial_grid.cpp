@@ -0,0 +1,77 @@
+// internal
+#include "bench.hpp"
+#include "spatial_grid.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <random>
+
+// Spatial grid with 10000 bodies over 4000x4000 px answering 1000 queries of each kind, the
+// load of a crowded frame. Usage: bench_spatial_grid
+const uint NUM_BODIES = 10000;
+const uint NUM_QUERIES = 1000;
+const float SCENE_SIZE = 4000.f;
+const float QUERY_RADIUS = 300.f;
+const float QUERY_BOX = 200.f;
+const float RAY_LENGTH = 500.f;
+const int RUNS = 50;
+const uint MAX_RESULTS = 4096;
+
+int main()
+{
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<float> coordinate(0.f, SCENE_SIZE);
+	std::uniform_real_distribution<float> size(10.f, 60.f);
+	std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+	for (uint i = 0; i < NUM_BODIES; i++) {
+		Entity entity = Entity();
+		// a mix of the layers the game queries
+		if (i % 4 == 0) registry.enemies.emplace(entity);
+		else if (i % 4 == 1) registry.projectiles.emplace(entity).hostile = (i % 8 == 1);
+		else if (i % 4 == 2) registry.terrain.emplace(entity);
+		Position& position = registry.positions.emplace(entity);
+		position.position = { coordinate(gen), coordinate(gen) };
+		position.scale = { size(gen), size(gen) };
+		registry.collidables.emplace(entity);
+	}
+
+	std::vector<vec2> points(NUM_QUERIES);
+	std::vector<vec2> directions(NUM_QUERIES);
+	for (uint q = 0; q < NUM_QUERIES; q++) {
+		points[q] = { coordinate(gen), coordinate(gen) };
+		float a = angle(gen);
+		directions[q] = { cos(a), sin(a) };
+	}
+	std::vector<uint> results(MAX_RESULTS);
+
+	double build_ms = averageMs(RUNS, [&]() { spatial_grid.build(); });
+
+	long long radius_hits = 0;
+	double radius_ms = averageMs(RUNS, [&]() {
+		radius_hits = 0;
+		for (vec2 point : points)
+			radius_hits += spatial_grid.query_radius(point, QUERY_RADIUS, LAYER_ALL, results.data(), MAX_RESULTS);
+	});
+
+	long long box_hits = 0;
+	double box_ms = averageMs(RUNS, [&]() {
+		box_hits = 0;
+		for (vec2 point : points)
+			box_hits += spatial_grid.query_aabb(point - QUERY_BOX / 2.f, point + QUERY_BOX / 2.f, LAYER_ALL, results.data(), MAX_RESULTS);
+	});
+
+	uint ray_hits = 0;
+	double ray_ms = averageMs(RUNS, [&]() {
+		ray_hits = 0;
+		RaycastHit hit;
+		for (uint q = 0; q < NUM_QUERIES; q++)
+			ray_hits += spatial_grid.raycast(points[q], directions[q], RAY_LENGTH, LAYER_TERRAIN, hit);
+	});
+
+	printf("%u bodies over %gx%g px\n", NUM_BODIES, SCENE_SIZE, SCENE_SIZE);
+	printf("build: %.3f ms\n", build_ms);
+	printf("%u radius %g px queries: %.3f ms, %.1f hits each\n", NUM_QUERIES, QUERY_RADIUS, radius_ms, (double)radius_hits / NUM_QUERIES);
+	printf("%u %g px box queries: %.3f ms, %.1f hits each\n", NUM_QUERIES, QUERY_BOX, box_ms, (double)box_hits / NUM_QUERIES);
+	printf("%u %g px terrain raycasts: %.3f ms, %u hit\n", NUM_QUERIES, RAY_LENGTH, ray_ms, ray_hits);
+	return 0;
+}
@@ -5,15 +5,23 @@ in vec2 texcoord;
 
 // Application data
 uniform sampler2D sampler0;
+uniform vec4 atlas_rect; // where the texture sits in the bound atlas page
 uniform vec3 fcolor;
 
-uniform float time;
 uniform int frame_col;
 uniform int frame_row;
 uniform float frame_width;
 uniform float frame_height;
 uniform bool rainbow_enabled;
 
+// Per frame data shared by every effect, see FrameUniforms
+layout(std140) uniform FrameData {
+	mat3 projection;
+	mat4 screen_projection;
+	vec2 window_size;
+	float time;
+};
+
 // Output color
 layout(location = 0) out  vec4 color;
 
@@ -83,6 +91,6 @@ void main()
 	vec2 uv = texcoord;
 	uv.x += frame_width * frame_col;
     uv.y += frame_height * frame_row;
-    vec4 out_color = texture(sampler0, uv);
+    vec4 out_color = texture(sampler0, atlas_rect.xy + uv * atlas_rect.zw);
     color = rainbow_enabled ? rainbow_shift(out_color) : out_color;
 }
@@ -5,6 +5,7 @@ in vec2 texcoord;
 
 // Application data
 uniform sampler2D sampler0;
+uniform vec4 atlas_rect; // where the texture sits in the bound atlas page
 uniform vec3 fcolor;
 uniform float fraction;
 uniform float logoRatio;
@@ -17,5 +18,5 @@ void main()
 {
 	float filled = fraction * barRatio + logoRatio;
 	float offset = texcoord.x <= filled ? 0.5 : 0.0;
-	color = vec4(fcolor, 1.0) * texture(sampler0, vec2(texcoord.x, texcoord.y + offset));
+	color = vec4(fcolor, 1.0) * texture(sampler0, atlas_rect.xy + vec2(texcoord.x, texcoord.y + offset) * atlas_rect.zw);
 }
@@ -1,12 +1,19 @@
 #version 330
 
 uniform sampler2D screen_texture;
-uniform vec2 window_size;
 uniform float screen_darken_factor;
 uniform float radius;
 uniform bool apply_spotlight;
 uniform float light_radius;
 
+// Per frame data shared by every effect, see FrameUniforms
+layout(std140) uniform FrameData {
+	mat3 projection;
+	mat4 screen_projection;
+	vec2 window_size;
+	float time;
+};
+
 in vec2 texcoord;
 
 layout(location = 0) out vec4 color;
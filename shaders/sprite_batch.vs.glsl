@@ -0,0 +1,35 @@
+#version 330
+
+// Input attributes, per vertex of the shared quad
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_texcoord;
+
+// Input attributes, per sprite instance
+layout(location = 2) in mat3 in_transform; // takes locations 2 to 4
+layout(location = 5) in vec4 in_uv_rect; // offset and size of the sprite's region of the texture
+layout(location = 6) in vec3 in_color;
+layout(location = 7) in float in_rainbow;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 sprite_color;
+out float rainbow;
+
+// Application data
+
+// Per frame data shared by every effect, see FrameUniforms
+layout(std140) uniform FrameData {
+	mat3 projection;
+	mat4 screen_projection;
+	vec2 window_size;
+	float time;
+};
+
+void main()
+{
+	texcoord = in_uv_rect.xy + in_texcoord * in_uv_rect.zw;
+	sprite_color = in_color;
+	rainbow = in_rainbow;
+	vec3 pos = projection * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
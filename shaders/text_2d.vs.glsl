@@ -2,12 +2,21 @@
 
 layout (location = 0) 
 in vec4 vertex; // <vec2 pos, vec2 tex>
+in vec3 in_color;
 out vec2 TexCoords;
+out vec3 TextColor;
 
-uniform mat4 projection;
+// Per frame data shared by every effect, see FrameUniforms
+layout(std140) uniform FrameData {
+	mat3 projection;
+	mat4 screen_projection;
+	vec2 window_size;
+	float time;
+};
 
 void main()
 {
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    gl_Position = screen_projection * vec4(vertex.xy, 0.0, 1.0);
     TexCoords = vertex.zw;
+    TextColor = in_color;
 }  
\ No newline at end of file
@@ -5,6 +5,7 @@ in vec2 texcoord;
 
 // Application data
 uniform sampler2D sampler0;
+uniform vec4 atlas_rect; // where the texture sits in the bound atlas page
 uniform vec3 fcolor;
 
 // Output color
@@ -12,5 +13,5 @@ layout(location = 0) out  vec4 color;
 
 void main()
 {
-	color = vec4(fcolor, 1.0) * texture(sampler0, vec2(texcoord.x, texcoord.y));
+	color = vec4(fcolor, 1.0) * texture(sampler0, atlas_rect.xy + texcoord * atlas_rect.zw);
 }
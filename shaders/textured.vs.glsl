@@ -9,7 +9,14 @@ out vec2 texcoord;
 
 // Application data
 uniform mat3 transform;
-uniform mat3 projection;
+
+// Per frame data shared by every effect, see FrameUniforms
+layout(std140) uniform FrameData {
+	mat3 projection;
+	mat4 screen_projection;
+	vec2 window_size;
+	float time;
+};
 
 void main()
 {
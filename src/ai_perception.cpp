@@ -0,0 +1,66 @@
+// internal
+#include "ai_perception.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "job_system.hpp"
+
+constexpr float AIPerception::NEIGHBOUR_RANGE;
+
+void AIPerception::begin(const SpatialGrid& grid_arg, const DangerMap& danger_arg, const FlowField& flow_arg)
+{
+	grid = &grid_arg;
+	danger = &danger_arg;
+	flow = &flow_arg;
+	player = registry.positions.get(registry.players.entities[0]).position;
+
+	// look up each enemy's health and type once instead of once per enemy that sees it
+	body_health.resize(grid->size());
+	body_type.resize(grid->size());
+	for (uint b = 0; b < grid->size(); b++) {
+		const SpatialGrid::Body& body = grid->body(b);
+		if (!(body.layer & LAYER_ENEMY)) continue;
+		Entity entity = body.entity;
+		body_health[b] = registry.resources.get(entity).currentHealth;
+		body_type[b] = registry.enemies.get(entity).type;
+	}
+
+	enemies.resize(registry.enemies.size());
+	for (uint i = 0; i < registry.enemies.size(); i++) {
+		Entity entity = registry.enemies.entities[i];
+		enemies[i].position = registry.positions.get(entity).position;
+		enemies[i].velocity = registry.velocities.get(entity).velocity;
+	}
+
+	neighbour_lists.resize(jobs.thread_count());
+	query_results.resize(jobs.thread_count());
+	for (uint worker = 0; worker < jobs.thread_count(); worker++) {
+		neighbour_lists[worker].clear();
+		query_results[worker].resize(grid->size());
+	}
+}
+
+void AIPerception::perceive(uint index, uint worker)
+{
+	Entity entity = registry.enemies.entities[index];
+	EnemyPerception& perception = enemies[index];
+	std::vector<NeighbourPerception>& neighbour_list = neighbour_lists[worker];
+	std::vector<uint>& found = query_results[worker];
+	perception.worker = worker;
+
+	perception.danger = danger->danger(perception.position);
+	perception.dodge_direction = danger->dodge_direction(perception.position, entity);
+	perception.chase_direction = flow->direction(perception.position);
+
+	perception.neighbour_begin = (uint)neighbour_list.size();
+	int num_found = grid->query_radius(perception.position, NEIGHBOUR_RANGE, LAYER_ENEMY, found.data(), (int)found.size());
+	for (int q = 0; q < num_found; q++) {
+		uint b = found[q];
+		const SpatialGrid::Body& body = grid->body(b);
+		Entity other = body.entity;
+		if ((uint)other == (uint)entity) continue;
+		vec2 other_pos = (body.min + body.max) / 2.f;
+		float dist = distance(other_pos, perception.position);
+		if (dist >= NEIGHBOUR_RANGE) continue;
+		neighbour_list.push_back({ (uint)other, other_pos, dist, body_health[b], body_type[b] });
+	}
+	perception.neighbour_count = (uint)neighbour_list.size() - perception.neighbour_begin;
+}
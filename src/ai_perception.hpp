@@ -0,0 +1,69 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+#include "spatial_grid.hpp"
+#include "danger_map.hpp"
+#include "flow_field.hpp"
+
+// stlib
+#include <vector>
+
+// Another enemy close enough to heal or flank with
+struct NeighbourPerception
+{
+	uint id; // entity id
+	vec2 position;
+	float distance;
+	float health;
+	ElementType type;
+};
+
+// Everything an enemy's decisions look at
+struct EnemyPerception
+{
+	vec2 position;
+	vec2 velocity;
+	float danger; // how close the enemy is to the path of a player projectile, see DangerMap
+	vec2 dodge_direction;
+	vec2 chase_direction; // toward the player around terrain, see FlowField
+	uint neighbour_begin; // neighbours are neighbours()[neighbour_begin] .. neighbours()[neighbour_begin + neighbour_count - 1]
+	uint neighbour_count;
+	uint worker; // job system thread that perceived the enemy, its neighbours are in that thread's list
+};
+
+// Snapshot of what enemies can perceive, filled in only for the enemies deciding this step.
+// Neighbours come from the spatial grid so each enemy only looks at the enemies in the cells
+// around it, projectiles are only seen through the danger map. Enemies are stored in the same
+// order as registry.enemies. begin reads the registry, perceive only reads what begin gathered,
+// so enemies can be perceived on different threads at once.
+class AIPerception
+{
+public:
+	static constexpr float NEIGHBOUR_RANGE = 250.f;
+
+	// Start a new step, then perceive each enemy that is going to decide
+	void begin(const SpatialGrid& grid, const DangerMap& danger, const FlowField& flow);
+	void perceive(uint index, uint worker);
+
+	vec2 player_position() const { return player; }
+	const EnemyPerception& enemy(uint index) const { return enemies[index]; }
+	const NeighbourPerception* neighbours(const EnemyPerception& enemy) const { return neighbour_lists[enemy.worker].data() + enemy.neighbour_begin; }
+	uint size() const { return (uint)enemies.size(); }
+
+private:
+	const SpatialGrid* grid = nullptr;
+	const DangerMap* danger = nullptr;
+	const FlowField* flow = nullptr;
+
+	vec2 player;
+	std::vector<EnemyPerception> enemies;
+	// per job system thread
+	std::vector<std::vector<NeighbourPerception>> neighbour_lists;
+	std::vector<std::vector<uint>> query_results;
+
+	// health and type of every enemy body in the grid, indexed by grid body
+	std::vector<float> body_health;
+	std::vector<ElementType> body_type;
+};
@@ -5,302 +5,333 @@
 #include "world_init.hpp"
 #include "world_system.hpp"
 #include "render_system.hpp"
-#include <chrono>
 #include <utils.hpp>
+#include <chrono>
+#include "spatial_grid.hpp"
+#include "danger_map.hpp"
+#include "flow_field.hpp"
+#include "boss_patterns.hpp"
+#include "projectile_volleys.hpp"
+#include "job_system.hpp"
+#include <climits>
+#include <cstdlib>
 
 #define ENEMY_PROJECTILE_SPEED 500
 
+// Enemies dodge once they are this close to the path of a player projectile, 1 is right on it
+const float DODGE_DANGER = 0.25f;
+const float DANGER_CELL_SIZE = 32.f;
+
+// Level of detail: enemies on screen or near the player decide every step, the rest less often
+const float LOD_SCREEN_MARGIN = 100.f;
+const float LOD_NEAR_RANGE = 500.f;
+const float LOD_MID_RANGE = 1200.f;
+const uint LOD_MID_INTERVAL = 4;
+const uint LOD_FAR_INTERVAL = 16;
+// Decisions per step before the remaining ones wait for the next, a count rather than a time
+// so the same schedule always decides the same enemies whatever the machine
+const uint AI_MAX_DECISIONS = 256;
+// Below this many decisions they are not worth splitting across threads
+const uint MIN_PARALLEL_DECISIONS = 64;
+// Steps between reports of the running decision hash when checking determinism
+const uint AI_CHECK_REPORT_STEPS = 1200;
+
+using Clock = std::chrono::high_resolution_clock;
+
 void animateEnemy(Entity& enemy_entity, vec2 velocity) {
 	Animation& animation = registry.animations.get(enemy_entity);
 	ENEMY_STATES state = (velocity.x > 0.f) ? ENEMY_STATES::WEST : ENEMY_STATES::EAST;
 	if ((int)state != animation.curr_state_index) animation.setState((int)state);
 }
 
+// True if no terrain blocks the straight line between the two points
+bool hasLineOfSight(vec2 from, vec2 to) {
+	float dist = distance(from, to);
+	if (dist == 0.f) return true;
+	RaycastHit hit;
+	return !spatial_grid.raycast(from, (to - from) / dist, dist, LAYER_TERRAIN, hit);
+}
+
+// How often an enemy runs its decisions, in AI steps
+uint decisionInterval(bool is_boss, vec2 position, vec2 player_pos, vec2 camera_center) {
+	if (is_boss) return 1; // boss attack patterns are timed to the step
+	vec2 from_camera = abs(position - camera_center);
+	bool on_screen = from_camera.x < window_width_px / 2 + LOD_SCREEN_MARGIN && from_camera.y < window_height_px / 2 + LOD_SCREEN_MARGIN;
+	float dist = distance(position, player_pos);
+	if (on_screen || dist <= LOD_NEAR_RANGE) return 1;
+	if (dist <= LOD_MID_RANGE) return LOD_MID_INTERVAL;
+	return LOD_FAR_INTERVAL;
+}
+
 void AISystem::step(float elapsed_ms)
 {
+	auto ai_start = Clock::now();
 	auto& enemy_container = registry.enemies;
-	Entity player = registry.players.entities[0];
-	for (uint i = 0; i < enemy_container.size(); i++)
-	{
+	step_count++;
+
+	// everything the decisions below look at is gathered up front
+	danger_map.build(DANGER_CELL_SIZE);
+	flow_field.update(registry.positions.get(registry.players.entities[0]).position);
+	perception.begin(spatial_grid, danger_map, flow_field);
+	vec2 playerPos = perception.player_position();
+	vec2 camera_center = (registry.lifeOrbs.size() > 0 && registry.lifeOrbs.components[0].centered_on_screen)
+		? registry.positions.get(registry.lifeOrbs.entities[0]).position
+		: playerPos;
+
+	// enemies carried over from the last step go first, then everyone due this step, nearest first
+	schedule.clear();
+	intervals.resize(enemy_container.size());
+	for (uint i = 0; i < enemy_container.size(); i++) {
 		Entity entity_i = enemy_container.entities[i];
-		Velocity& vel_i = registry.velocities.get(entity_i);
-		Enemy& enemy = enemy_container.get(entity_i);
-
-		vec2 playerPos = registry.positions.get(player).position;
-		vec2 thisPos = registry.positions.get(entity_i).position;
-		float dist = distance(playerPos, thisPos);
-		
-		bool canSprint = enemy.stamina > 0;
-		bool isDodging = false;
-		bool isSprinting = false;
-		bool isFlanking = false;
-
-		if (registry.bosses.has(entity_i) && enemy.isAggravated) {
-			Boss& boss = registry.bosses.get(entity_i);
-			if (boss.phaseTimer > 0.f) {
-				boss.phaseTimer -= elapsed_ms;
-			} else {
-				// printf("Resolving phase %d:%d\n", boss.phase, boss.subphase);
-				switch (boss.phase) {
-					case 0:
-						if (boss.subphase == 48) {
-							boss.phase += 1;
-							boss.phaseTimer = 5000.f;
-							boss.subphase = 0;
-						} else {
-							for (int deg = boss.subphase * 2; deg < 360 + boss.subphase * 2; deg += 120) {
-								float rad = deg * 180 / 3.14;
-								vec2 direction = {cosf(rad), sinf(rad)};
-								enemyFireProjectile(entity_i, direction, 0.5f);
-							}
-							boss.subphase += 1;
-							boss.phaseTimer = 50.f;
-						}
-						break;
-					case 1:
-					case 2:
-					case 3:
-					case 4:
-					case 5:
-					case 6:
-					case 7:
-						if (boss.subphase == 10) {
-							boss.phaseTimer = 50.f;
-							if (boss.phase == 7) {
-								boss.phaseTimer = 1500.f;
-							}
-							boss.phase += 1;
-							boss.subphase = 0;
-						} else {
-							vec2 direction = {1.f, 0.f};
-							if (boss.subphase >= 5) {
-								direction = {-1.f, 0.f};
-							}
-							// vec2 position = registry.positions.get(entity_i).position;
-							vec2 adjust = {0, (boss.phase - 4) * 50};
-							vec2 subadjust = {0, ((boss.subphase % 5) + 1) * 75 + 40};
-							enemyFireProjectile(entity_i, direction, 0.5f, thisPos - adjust + subadjust);
-							enemyFireProjectile(entity_i, direction, 0.5f, thisPos - adjust - subadjust);
-							boss.subphase += 1;
-							boss.phaseTimer = 25.f;
-						}
-						break;
-					case 8:
-						if (boss.subphase == 25) {
-							boss.phase += 1;
-							boss.phaseTimer = 1500.f;
-							boss.subphase = 0;
-						} else {
-							registry.resources.get(entity_i).currentHealth += 25;
-							if (registry.resources.get(entity_i).currentHealth > registry.resources.get(entity_i).maxHealth) {
-								registry.resources.get(entity_i).currentHealth = registry.resources.get(entity_i).maxHealth;
-							}
-							boss.subphase += 1;
-							boss.phaseTimer = 50.f;
-						}
-						break;
-					case 9:
-						if (boss.subphase == 4) {
-							boss.phase += 1;
-							boss.phaseTimer = 1000.f;
-							boss.subphase = 0;
-						} else {
-							for (int deg = 0; deg < 360; deg += 10) {
-								float rad = deg * 180 / 3.14;
-								vec2 direction = {cosf(rad), sinf(rad)};
-								if (boss.subphase == 0) {
-									direction *= 200;
-								} else {
-									direction *= 150 * (boss.subphase + 1);
-								}
-								enemyFireProjectile(entity_i, - direction, 0.0f, playerPos + direction);
-							}
-							boss.subphase += 1;
-							boss.phaseTimer = 100.f;
-						}
-						break;
-					case 10:
-					case 11:
-					case 12:
-					case 13:
-					case 14:
-						for (uint i = 0; i < registry.projectiles.size(); i++) {
-							Entity thisProj = registry.projectiles.entities[i];
-							if (!registry.projectiles.get(thisProj).hostile) continue;
-							Velocity& thisProjVel = registry.velocities.get(thisProj);
-							switch (boss.phase) {
-								case 10:
-									// make sure the circle does not lead back into the boss
-									thisProjVel.velocity = normalize(playerPos - thisPos);
-									thisProjVel.velocity *= 200;
-									break;
-								case 11:
-									thisProjVel.velocity = {-150, 0};
-									break;
-								case 12:
-									thisProjVel.velocity = {0, 150};
-									break;
-								case 13:
-									thisProjVel.velocity = {150, 0};
-									break;
-								case 14:
-									thisProjVel.velocity = {0, -150};
-									break;
-							}
-						}
-						boss.phaseTimer = 750.f;
-						if (boss.phase == 10) {
-							boss.phaseTimer = 1000.f;
-						}
-						boss.phase += 1;
-						boss.subphase = 0;
-						break;
-					case 15:
-					case 16:
-						for (uint i = 0; i < registry.projectiles.size(); i++) {
-							Entity thisProj = registry.projectiles.entities[i];
-							if (!registry.projectiles.get(thisProj).hostile) continue;
-							Velocity& thisProjVel = registry.velocities.get(thisProj);
-							Position& thisProjPos = registry.positions.get(thisProj);
-							thisProjVel.velocity = normalize(thisProjPos.position - playerPos);
-							thisProjVel.velocity *= 100;
-							if (boss.phase == 15) {
-								thisProjVel.velocity *= -0.75;
-							}
-						}
-						boss.phase += 1;
-						boss.phaseTimer = 1000.f;
-						boss.subphase = 0;
-						break;
-					case 17:
-						while (0 != registry.projectiles.size()) {
-							if (registry.projectiles.entities.size() != 0) {
-								registry.remove_all_components_of_no_collision(registry.projectiles.entities[0]);
-							}
-						}
-						boss.phase += 1;
-						boss.phaseTimer = 1500.f;
-						boss.subphase = 0;
-						break;
-					default:
-						boss.phaseTimer = 2500.f;
-						boss.phase = 0; // reset to first phase
-						break;
-				}
-			}
+		Enemy& enemy = enemy_container.components[i];
+		enemy.ai_elapsed_ms += elapsed_ms;
+		intervals[i] = decisionInterval(registry.bosses.has(entity_i), registry.positions.get(entity_i).position, playerPos, camera_center);
+		if (enemy.ai_deferred) schedule.push_back(i);
+	}
+	for (uint interval : { 1u, LOD_MID_INTERVAL, LOD_FAR_INTERVAL }) {
+		for (uint i = 0; i < enemy_container.size(); i++) {
+			if (intervals[i] != interval || enemy_container.components[i].ai_deferred) continue;
+			// enemies further away take turns, spread over the interval by entity id
+			if ((step_count + (uint)enemy_container.entities[i]) % interval == 0) schedule.push_back(i);
 		}
+	}
 
-		if (!registry.bosses.has(entity_i)) { // bosses never dodge
-			for (uint i = 0; i < registry.projectiles.size(); i++) {
-				Entity entity_p = registry.projectiles.entities[i];
-				Projectile& projectile = registry.projectiles.get(entity_p);
-				if (projectile.hostile) continue;
-				vec2 projectilePos = registry.positions.get(entity_p).position;
-				if (distance(projectilePos, thisPos) < 300) {
-					isDodging = true;
-					if (canSprint) {
-						isSprinting = true;
-						enemy.stamina -= elapsed_ms / 1000;
-					}
-
-					int deg = 90;
-					// https://stackoverflow.com/questions/16177295/get-time-since-epoch-in-milliseconds-preferably-using-c11-chrono
-					unsigned long milliseconds_since_epoch = std::chrono::system_clock::now().time_since_epoch() / std::chrono::milliseconds(1);
-					if (milliseconds_since_epoch % 10000 > 5000) {
-						deg = -90;
-					}
-					float c = cosf(deg);
-					float s = sinf(deg);
-					mat2 R = {{c, s}, {-s, c}};
-
-					vec2 direction = projectilePos - thisPos;
-					direction /= length(direction);
-					direction *= isSprinting ? 300 : 50; // allow enemies to sprint even faster to dodge
-					vel_i.velocity = direction * R;
-				}
-			}
+	// whoever does not fit in the budget goes first next step
+	uint num_updated = std::min((uint)schedule.size(), AI_MAX_DECISIONS);
+	for (uint s = 0; s < schedule.size(); s++)
+		enemy_container.components[schedule[s]].ai_deferred = (s >= num_updated);
+
+	// boss patterns create and remove projectiles, so they run before the decisions
+	for (uint s = 0; s < num_updated; s++) {
+		Entity entity_i = enemy_container.entities[schedule[s]];
+		if (!registry.bosses.has(entity_i) || !enemy_container.components[schedule[s]].isAggravated) continue;
+		boss_spawns.clear();
+		Boss& boss = registry.bosses.get(entity_i);
+		runBossPattern(entity_i, boss, playerPos, enemy_container.components[schedule[s]].ai_elapsed_ms, boss_spawns);
+		emitProjectiles(entity_i, boss_spawns, boss.volley);
+	}
+
+	// decide on all threads, each into its own intents
+	if (check_determinism) enemies_before = enemy_container.components;
+	decideScheduled(num_updated, MIN_PARALLEL_DECISIONS);
+	if (check_determinism) checkDeterminism(num_updated);
+
+	// apply in schedule order, the threads got contiguous ranges of it, so projectiles are
+	// created in the same order whatever the thread count
+	for (AIIntents& intents : thread_intents) {
+		for (MoveIntent& move : intents.moves) {
+			Entity entity = enemy_container.entities[move.enemy];
+			registry.velocities.get(entity).velocity = move.velocity;
+			animateEnemy(entity, move.velocity);
+		}
+		for (FireIntent& fire : intents.fires) {
+			Entity entity = enemy_container.entities[fire.enemy];
+			enemyFireProjectile(entity, fire.direction);
 		}
+	}
 
-		if (enemy.mana < 1.f) {
-			enemy.mana += elapsed_ms / 1000;
+	// patrols keep turning on time between decisions
+	for (uint i = 0; i < enemy_container.size(); i++) {
+		if (enemy_container.components[i].patrolling)
+			patrol(enemy_container.entities[i], enemy_container.components[i], elapsed_ms);
+	}
+
+	perf_stats.ai_budget = AI_MAX_DECISIONS;
+	perf_stats.ai_used_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - ai_start)).count() / 1000;
+	perf_stats.ai_updated = num_updated;
+	perf_stats.ai_deferred = (uint)schedule.size() - num_updated;
+}
+
+void AISystem::decideScheduled(uint num_updated, uint min_parallel)
+{
+	thread_intents.resize(jobs.thread_count());
+	for (AIIntents& intents : thread_intents) {
+		intents.moves.clear();
+		intents.fires.clear();
+	}
+	jobs.parallel_for(num_updated, min_parallel, [this](uint begin, uint end, uint worker) {
+		for (uint s = begin; s < end; s++) {
+			perception.perceive(schedule[s], worker);
+			Enemy& enemy = registry.enemies.components[schedule[s]];
+			decide(schedule[s], enemy.ai_elapsed_ms, thread_intents[worker]);
+			enemy.ai_elapsed_ms = 0.f;
 		}
+	});
+}
 
+// FNV-1a over the bytes of a value
+template <typename T>
+void hashValue(uint64_t& hash, const T& value)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+	for (size_t b = 0; b < sizeof(T); b++) {
+		hash ^= bytes[b];
+		hash *= 0x100000001b3ULL;
+	}
+}
 
-		for (uint j = 0; j < enemy_container.size(); j++) {
-			if (i == j) continue;
-			Entity entity_j = enemy_container.entities[j];
-			Enemy& enemy_j = enemy_container.get(entity_j);
-			if (distance(registry.positions.get(entity_j).position, thisPos) < 250 && registry.resources.get(entity_j).currentHealth < 80 && enemy_j.type != enemy.type) {
-				vec2 direction = registry.positions.get(entity_j).position - thisPos;
-				direction /= length(direction);
-				if (enemy.mana >= 0.75f) {
-					enemyFireProjectile(entity_i, direction);
-					enemy.mana -= 0.75f;
-				}
-			}
-			// flank the player
-			if (distance(thisPos, registry.positions.get(entity_j).position) < 100 && i > j) {
-				vec2 direction = playerPos - thisPos;
-				direction /= length(direction);
-				direction *= -50;
-				if (distance(thisPos, playerPos) > 100) {
-					vel_i.velocity = direction;
-				}
-				isFlanking = true;
-			}
+// Everything the decide phase produced: the intents in apply order and the state the
+// scheduled enemies were left in
+uint64_t AISystem::decisionHash(uint num_updated)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const AIIntents& intents : thread_intents) {
+		for (const MoveIntent& move : intents.moves) {
+			hashValue(hash, move.enemy);
+			hashValue(hash, move.velocity);
 		}
+		for (const FireIntent& fire : intents.fires) {
+			hashValue(hash, fire.enemy);
+			hashValue(hash, fire.direction);
+		}
+	}
+	for (uint s = 0; s < num_updated; s++) {
+		const Enemy& enemy = registry.enemies.components[schedule[s]];
+		hashValue(hash, enemy.stamina);
+		hashValue(hash, enemy.mana);
+		hashValue(hash, enemy.movementTimer);
+		hashValue(hash, enemy.patrolling);
+	}
+	return hash;
+}
+
+// Decides the step again on the calling thread alone, from the enemies as they were before,
+// and stops if the outcome differs from the threaded run in any bit
+void AISystem::checkDeterminism(uint num_updated)
+{
+	uint64_t threaded = decisionHash(num_updated);
+	registry.enemies.components = enemies_before;
+	decideScheduled(num_updated, UINT_MAX);
+	uint64_t serial = decisionHash(num_updated);
+	if (serial != threaded) {
+		fprintf(stderr, "AI decisions differ between %u threads and 1 on step %u\n", jobs.thread_count(), step_count);
+		assert(false);
+	}
+	hashValue(checked_hash, serial);
+	if (step_count % AI_CHECK_REPORT_STEPS == 0)
+		printf("AI check: step %u matches on %u threads, hash %016llx\n", step_count, jobs.thread_count(), (unsigned long long)checked_hash);
+}
+
+void AISystem::patrol(Entity entity, Enemy& enemy, float elapsed_ms)
+{
+	Velocity& velocity = registry.velocities.get(entity);
+	if (enemy.movementTimer <= 0.f) {
+		enemy.movementTimer = 3000.f;
+		velocity.velocity.x = -velocity.velocity.x;
+		animateEnemy(entity, velocity.velocity);
+	} else {
+		enemy.movementTimer -= elapsed_ms;
+	}
+}
+
+// Runs the decision tree of one enemy, elapsed_ms is the time since it last ran. Only reads
+// the perception and the enemy's own state, what it decides to do goes into intents, so any
+// number of enemies can decide at once.
+void AISystem::decide(uint i, float elapsed_ms, AIIntents& intents)
+{
+	auto& enemy_container = registry.enemies;
+	vec2 playerPos = perception.player_position();
+	Entity entity_i = enemy_container.entities[i];
+	Enemy& enemy = enemy_container.components[i];
+	const EnemyPerception& seen = perception.enemy(i);
+	vec2 velocity = seen.velocity;
+
+	vec2 thisPos = seen.position;
+	float dist = distance(playerPos, thisPos);
+	
+	bool canSprint = enemy.stamina > 0;
+	bool isDodging = false;
+	bool isSprinting = false;
+	bool isFlanking = false;
+	bool isPatrolling = false;
+
+	if (!registry.bosses.has(entity_i) && seen.danger > DODGE_DANGER) { // bosses never dodge
+		isDodging = true;
+		if (canSprint) {
+			isSprinting = true;
+			enemy.stamina -= elapsed_ms / 1000;
+		}
+		// allow enemies to sprint even faster to dodge
+		velocity = seen.dodge_direction * (isSprinting ? 300.f : 50.f);
+	}
+
+	if (enemy.mana < 1.f) {
+		enemy.mana += elapsed_ms / 1000;
+	}
+
 
-		if (!isDodging && !isFlanking) {
-			// bosses never give chase
-			if (dist <= 350 && dist > 15 && !registry.bosses.has(entity_i) && enemy.isAggravated) {
-				if (canSprint) {
-					isSprinting = true;
-					enemy.stamina -= elapsed_ms / 1000;
-				}
-				vec2 direction = playerPos - thisPos;
-				direction /= length(direction);
-				if (enemy.mana >= 1.f) {
-					enemyFireProjectile(entity_i, direction);
-					enemy.mana -= 1.f;
-				}
-				direction *= isSprinting ? 200 : 50;
-				vel_i.velocity = direction;
-			} else if (dist > 350 || !enemy.isAggravated) {
-				vel_i.velocity.y = 0;
-				if (abs(vel_i.velocity.x) != 50) {
-					vel_i.velocity.x = 50;
-				}
-				if (enemy.movementTimer <= 0.f) {
-					enemy.movementTimer = 3000.f;
-					vel_i.velocity.x = -vel_i.velocity.x;
-				} else {
-					enemy.movementTimer -= elapsed_ms;
-				}
+	const NeighbourPerception* neighbours = perception.neighbours(seen);
+	for (uint n = 0; n < seen.neighbour_count; n++) {
+		const NeighbourPerception& neighbour = neighbours[n];
+		if (neighbour.health < 80 && neighbour.type != enemy.type) {
+			vec2 direction = neighbour.position - thisPos;
+			direction /= length(direction);
+			if (enemy.mana >= 0.75f && hasLineOfSight(thisPos, neighbour.position)) {
+				intents.fires.push_back({ i, direction });
+				enemy.mana -= 0.75f;
 			}
 		}
+		// flank the player, only one enemy of each close pair does so
+		if (neighbour.distance < 100 && (uint)entity_i > neighbour.id) {
+			vec2 direction = playerPos - thisPos;
+			direction /= length(direction);
+			direction *= -50;
+			if (distance(thisPos, playerPos) > 100) {
+				velocity = direction;
+			}
+			isFlanking = true;
+		}
+	}
 
-		if (!isSprinting) {
-			// replenish 1 stamina per second if not sprinting
-			enemy.stamina += elapsed_ms / 1000;
+	if (!isDodging && !isFlanking) {
+		// bosses never give chase
+		if (dist <= 350 && dist > 15 && !registry.bosses.has(entity_i) && enemy.isAggravated) {
+			if (canSprint) {
+				isSprinting = true;
+				enemy.stamina -= elapsed_ms / 1000;
+			}
+			vec2 direction = playerPos - thisPos;
+			direction /= length(direction);
+			if (enemy.mana >= 1.f && hasLineOfSight(thisPos, playerPos)) {
+				intents.fires.push_back({ i, direction });
+				enemy.mana -= 1.f;
+			}
+			// walk around walls along the flow field, straight at the player once in their cell
+			if (seen.chase_direction != vec2(0.f, 0.f)) direction = seen.chase_direction;
+			direction *= isSprinting ? 200 : 50;
+			velocity = direction;
+		} else if (dist > 350 || !enemy.isAggravated) {
+			velocity.y = 0;
+			if (abs(velocity.x) != 50) {
+				velocity.x = 50;
+			}
+			// turning around is left to patrol, which runs every step
+			isPatrolling = true;
 		}
+	}
+	enemy.patrolling = isPatrolling;
 
-		animateEnemy(entity_i, vel_i.velocity);
-
-		// Decision tree:
-		// Is there a player-made projectile within 50 pixels?
-		//   Yes -> Do I have stamina?
-		//     Yes -> Try to dodge at sprint speed
-		//     No -> Try to dodge at normal speed
-		//   No -> Is player within 350 pixels?
-		//     Yes -> Do I have mana?
-		//       Yes -> Fire a projectile at the player
-		//       No -> Do I have stamina?
-		//             Yes -> Sprint towards player
-		//             No -> Move towards player
-		//     No -> Have I moved in current direction for long enough?
-		//           Yes -> Flip direction
-		//           No -> Continue moving
+	if (!isSprinting) {
+		// replenish 1 stamina per second if not sprinting
+		enemy.stamina += elapsed_ms / 1000;
 	}
+
+	intents.moves.push_back({ i, velocity });
+
+	// Decision tree:
+	// Is there a player-made projectile within 50 pixels?
+	//   Yes -> Do I have stamina?
+	//     Yes -> Try to dodge at sprint speed
+	//     No -> Try to dodge at normal speed
+	//   No -> Is player within 350 pixels?
+	//     Yes -> Do I have mana?
+	//       Yes -> Fire a projectile at the player
+	//       No -> Do I have stamina?
+	//             Yes -> Sprint towards player
+	//             No -> Move towards player
+	//     No -> Have I moved in current direction for long enough?
+	//           Yes -> Flip direction
+	//           No -> Continue moving
 }
 
 
@@ -315,7 +346,7 @@ bool AISystem::enemyFireProjectile(Entity& enemy, vec2 direction, float speedMul
 
 	// Get current player projectile type
 	ElementType elementType = registry.enemies.get(enemy).type;
-	if (elementType == ElementType::COMBO) elementType = getRandomElementType();
+	if (elementType == ElementType::COMBO) elementType = getRandomElementType(RNG_COMBAT);
 
 	createProjectile(renderer, position, vel, elementType, true, enemy);
 	//															 ^^^^^ doesnt matter as ignored by the hostile = true
@@ -323,6 +354,15 @@ bool AISystem::enemyFireProjectile(Entity& enemy, vec2 direction, float speedMul
 	return true;
 }
 
+void AISystem::emitProjectiles(Entity& enemy, const std::vector<ProjectileSpawn>& spawns, uint volley) {
+	ElementType enemyType = registry.enemies.get(enemy).type;
+	for (const ProjectileSpawn& spawn : spawns) {
+		ElementType elementType = (enemyType == ElementType::COMBO) ? getRandomElementType(RNG_COMBAT) : enemyType;
+		Entity projectile = createProjectile(renderer, spawn.position, spawn.velocity, elementType, true, enemy);
+		volleys.add(volley, projectile);
+	}
+}
+
 bool AISystem::enemyFireProjectile(Entity& enemy, vec2 direction, float speedMultiplier) {
 	return enemyFireProjectile(enemy, direction, speedMultiplier, registry.positions.get(enemy).position);
 }
@@ -333,4 +373,6 @@ bool AISystem::enemyFireProjectile(Entity& enemy, vec2 direction) {
 
 void AISystem::init(RenderSystem* renderer_arg) {
 	this->renderer = renderer_arg;
+	// set ARIA_CHECK_AI to compare every threaded decide phase against a serial one
+	check_determinism = std::getenv("ARIA_CHECK_AI") != nullptr;
 }
\ No newline at end of file
@@ -5,19 +5,58 @@
 #include "tiny_ecs_registry.hpp"
 #include "common.hpp"
 #include "render_system.hpp"
+#include "ai_perception.hpp"
+#include "boss_patterns.hpp"
 
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // DON'T WORRY ABOUT THIS CLASS UNTIL ASSIGNMENT 3
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
+// What an enemy decided to do, applied once every enemy has decided
+struct MoveIntent
+{
+	uint enemy; // index into registry.enemies
+	vec2 velocity;
+};
+
+// A projectile to fire at the player or at a hurt ally
+struct FireIntent
+{
+	uint enemy;
+	vec2 direction;
+};
+
+struct AIIntents
+{
+	std::vector<MoveIntent> moves;
+	std::vector<FireIntent> fires;
+};
+
 class AISystem
 {
 public:
 	void step(float elapsed_ms);
 	void init(RenderSystem* renderer);
 private:
+	// Runs the decisions of the first num_updated scheduled enemies, split across threads
+	void decideScheduled(uint num_updated, uint min_parallel);
+	void decide(uint i, float elapsed_ms, AIIntents& intents);
+	uint64_t decisionHash(uint num_updated);
+	void checkDeterminism(uint num_updated);
+	void patrol(Entity entity, Enemy& enemy, float elapsed_ms);
+	// Create a batch of hostile projectiles fired by enemy, all added to volley
+	void emitProjectiles(Entity& enemy, const std::vector<ProjectileSpawn>& spawns, uint volley);
 	bool enemyFireProjectile(Entity& enemy, vec2 direction);
 	bool enemyFireProjectile(Entity& enemy, vec2 direction, float speedMultiplier);
 	bool enemyFireProjectile(Entity& enemy, vec2 direction, float speedMultiplier, vec2 position);
 	RenderSystem* renderer;
+	AIPerception perception;
+	std::vector<uint> schedule; // enemies deciding this step, by index into registry.enemies
+	std::vector<uint> intervals; // steps between decisions of each enemy
+	uint step_count = 0;
+	bool check_determinism = false;
+	std::vector<Enemy> enemies_before; // enemies before the threaded decide phase, when checking
+	uint64_t checked_hash = 0xcbf29ce484222325ULL; // every checked step so far, same seed and input give the same value
+	std::vector<AIIntents> thread_intents; // one per job system thread
+	std::vector<ProjectileSpawn> boss_spawns;
 };
\ No newline at end of file
@@ -0,0 +1,212 @@
+// internal
+#include "boss_patterns.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "projectile_volleys.hpp"
+
+// stlib
+#include <algorithm>
+
+BossInstruction emitRing(BOSS_ANCHOR anchor, int count, float angle, float angle_step, float radius, float speed, int repeat, float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::EMIT_RING;
+	instruction.repeat = repeat;
+	instruction.interval_ms = interval_ms;
+	instruction.anchor = anchor;
+	instruction.count = count;
+	instruction.radius = radius;
+	instruction.speed = speed;
+	// the only trig a pattern ever does
+	for (int run = 0; run < repeat; run++) {
+		for (int i = 0; i < count; i++) {
+			float rad = (angle + run * angle_step + i * 360.f / count) * (float)M_PI / 180.f;
+			instruction.directions.push_back({ cos(rad), sin(rad) });
+		}
+	}
+	return instruction;
+}
+
+BossInstruction emitLine(vec2 direction, vec2 offset, vec2 spread, vec2 spread_step, float speed, int repeat, float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::EMIT_LINE;
+	instruction.repeat = repeat;
+	instruction.interval_ms = interval_ms;
+	instruction.direction = direction;
+	instruction.offset = offset;
+	instruction.spread = spread;
+	instruction.spread_step = spread_step;
+	instruction.speed = speed;
+	return instruction;
+}
+
+BossInstruction steerVolley(STEER_MODE mode, vec2 direction, float speed, float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::STEER_VOLLEY;
+	instruction.interval_ms = interval_ms;
+	instruction.steer = mode;
+	instruction.direction = direction;
+	instruction.speed = speed;
+	return instruction;
+}
+
+BossInstruction scaleVolley(float factor, float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::STEER_VOLLEY;
+	instruction.interval_ms = interval_ms;
+	instruction.steer = STEER_MODE::SCALE_SPEED;
+	instruction.amount = factor;
+	return instruction;
+}
+
+BossInstruction heal(float amount, int repeat, float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::HEAL;
+	instruction.repeat = repeat;
+	instruction.interval_ms = interval_ms;
+	instruction.amount = amount;
+	return instruction;
+}
+
+BossInstruction clearProjectiles(float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::CLEAR;
+	instruction.interval_ms = interval_ms;
+	return instruction;
+}
+
+BossInstruction wait(float interval_ms)
+{
+	BossInstruction instruction;
+	instruction.op = BOSS_OP::WAIT;
+	instruction.interval_ms = interval_ms;
+	return instruction;
+}
+
+const vec2 EAST = { 1.f, 0.f };
+const vec2 WEST = { -1.f, 0.f };
+const vec2 NORTH = { 0.f, -1.f };
+const vec2 SOUTH = { 0.f, 1.f };
+
+// the pairs of a sweep start 115 px above and below its centre and spread 75 px further each shot
+const vec2 SWEEP_SPREAD = { 0.f, 115.f };
+const vec2 SWEEP_SPREAD_STEP = { 0.f, 75.f };
+
+const std::vector<BossPattern> BOSS_PATTERNS = {
+	// 0: the pattern every boss used to have hard coded
+	{
+		// spiral of three arms
+		emitRing(BOSS_ANCHOR::BOSS, 3, 0.f, 2.f, 0.f, 250.f, 48, 50.f),
+		wait(5000.f),
+		// sweeps east then west, centred a little higher on the boss each time
+		emitLine(EAST, { 0.f, 150.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, 150.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(50.f),
+		emitLine(EAST, { 0.f, 100.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, 100.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(50.f),
+		emitLine(EAST, { 0.f, 50.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, 50.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(50.f),
+		emitLine(EAST, { 0.f, 0.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, 0.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(50.f),
+		emitLine(EAST, { 0.f, -50.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, -50.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(50.f),
+		emitLine(EAST, { 0.f, -100.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, -100.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(50.f),
+		emitLine(EAST, { 0.f, -150.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		emitLine(WEST, { 0.f, -150.f }, SWEEP_SPREAD, SWEEP_SPREAD_STEP, 250.f, 5, 25.f),
+		wait(1500.f),
+		heal(25.f, 25, 50.f),
+		wait(1500.f),
+		// cage of still projectiles around the player
+		emitRing(BOSS_ANCHOR::PLAYER, 36, 0.f, 0.f, 200.f, 0.f, 1, 100.f),
+		emitRing(BOSS_ANCHOR::PLAYER, 36, 0.f, 0.f, 300.f, 0.f, 1, 100.f),
+		emitRing(BOSS_ANCHOR::PLAYER, 36, 0.f, 0.f, 450.f, 0.f, 1, 100.f),
+		emitRing(BOSS_ANCHOR::PLAYER, 36, 0.f, 0.f, 600.f, 0.f, 1, 100.f),
+		wait(1000.f),
+		// then push everything around
+		steerVolley(STEER_MODE::BOSS_TO_PLAYER, { 0.f, 0.f }, 200.f, 1000.f),
+		steerVolley(STEER_MODE::FIXED, WEST, 150.f, 750.f),
+		steerVolley(STEER_MODE::FIXED, SOUTH, 150.f, 750.f),
+		steerVolley(STEER_MODE::FIXED, EAST, 150.f, 750.f),
+		steerVolley(STEER_MODE::FIXED, NORTH, 150.f, 750.f),
+		steerVolley(STEER_MODE::TOWARD_PLAYER, { 0.f, 0.f }, 75.f, 1000.f),
+		steerVolley(STEER_MODE::TOWARD_PLAYER, { 0.f, 0.f }, -100.f, 1000.f),
+		clearProjectiles(1500.f),
+		wait(2500.f),
+	},
+};
+
+void runBossPattern(Entity boss_entity, Boss& boss, vec2 player_pos, float elapsed_ms, std::vector<ProjectileSpawn>& spawns)
+{
+	if (boss.phaseTimer > 0.f) {
+		boss.phaseTimer -= elapsed_ms;
+		return;
+	}
+
+	if (boss.volley == 0) boss.volley = volleys.create();
+	const BossPattern& pattern = BOSS_PATTERNS[boss.pattern];
+	const BossInstruction& instruction = pattern[boss.phase];
+	vec2 boss_pos = registry.positions.get(boss_entity).position;
+	switch (instruction.op) {
+		case BOSS_OP::EMIT_RING: {
+			vec2 center = (instruction.anchor == BOSS_ANCHOR::PLAYER) ? player_pos : boss_pos;
+			const vec2* directions = instruction.directions.data() + boss.subphase * instruction.count;
+			for (int i = 0; i < instruction.count; i++) {
+				vec2 out = directions[i] * instruction.radius;
+				// rings with a radius close in on their centre
+				vec2 heading = (instruction.radius > 0.f) ? -directions[i] : directions[i];
+				spawns.push_back({ center + out, heading * instruction.speed });
+			}
+			break;
+		}
+		case BOSS_OP::EMIT_LINE: {
+			vec2 spread = instruction.spread + instruction.spread_step * (float)boss.subphase;
+			vec2 velocity = instruction.direction * instruction.speed;
+			spawns.push_back({ boss_pos + instruction.offset + spread, velocity });
+			spawns.push_back({ boss_pos + instruction.offset - spread, velocity });
+			break;
+		}
+		case BOSS_OP::STEER_VOLLEY:
+			switch (instruction.steer) {
+				case STEER_MODE::FIXED:
+					volleys.set_velocity(boss.volley, instruction.direction * instruction.speed);
+					break;
+				case STEER_MODE::BOSS_TO_PLAYER:
+					volleys.set_velocity(boss.volley, normalize(player_pos - boss_pos) * instruction.speed);
+					break;
+				case STEER_MODE::TOWARD_PLAYER:
+					volleys.steer_toward(boss.volley, player_pos, instruction.speed);
+					break;
+				case STEER_MODE::SCALE_SPEED:
+					volleys.scale_speed(boss.volley, instruction.amount);
+					break;
+			}
+			break;
+		case BOSS_OP::HEAL: {
+			Resources& resources = registry.resources.get(boss_entity);
+			resources.currentHealth = std::min(resources.currentHealth + instruction.amount, resources.maxHealth);
+			break;
+		}
+		case BOSS_OP::CLEAR:
+			volleys.despawn(boss.volley);
+			break;
+		case BOSS_OP::WAIT:
+			break;
+	}
+
+	boss.phaseTimer = instruction.interval_ms;
+	boss.subphase++;
+	if (boss.subphase >= instruction.repeat) {
+		boss.subphase = 0;
+		boss.phase = (boss.phase + 1) % (int)pattern.size();
+	}
+}
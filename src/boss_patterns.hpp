@@ -0,0 +1,77 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+
+// stlib
+#include <vector>
+
+enum class BOSS_OP {
+	EMIT_RING = 0, // count projectiles evenly around a circle
+	EMIT_LINE = EMIT_RING + 1, // a pair of projectiles mirrored about an offset, all fired one way
+	STEER_VOLLEY = EMIT_LINE + 1, // change the velocity of every projectile the boss has fired
+	HEAL = STEER_VOLLEY + 1,
+	CLEAR = HEAL + 1, // remove every projectile the boss has fired
+	WAIT = CLEAR + 1
+};
+
+// What a ring is centred on
+enum class BOSS_ANCHOR {
+	BOSS = 0,
+	PLAYER = BOSS + 1
+};
+
+enum class STEER_MODE {
+	FIXED = 0, // every projectile along direction
+	BOSS_TO_PLAYER = FIXED + 1, // every projectile along the line from the boss to the player
+	TOWARD_PLAYER = BOSS_TO_PLAYER + 1, // each projectile at the player, away from it for a negative speed
+	SCALE_SPEED = TOWARD_PLAYER + 1 // every projectile's speed multiplied by amount
+};
+
+// One step of a boss attack pattern. It runs repeat times, interval_ms apart, before the pattern
+// moves on to the next instruction. Build them with the helpers below.
+struct BossInstruction
+{
+	BOSS_OP op;
+	int repeat = 1;
+	float interval_ms = 0.f;
+
+	float speed = 0.f; // of emitted or steered projectiles, in px/s
+	vec2 direction = { 0.f, 0.f }; // of lines and FIXED steering
+	vec2 offset = { 0.f, 0.f }; // line centre from the boss
+	vec2 spread = { 0.f, 0.f }; // line distance of the pair from the centre on the first run
+	vec2 spread_step = { 0.f, 0.f }; // added to spread on every later run
+	BOSS_ANCHOR anchor = BOSS_ANCHOR::BOSS;
+	float radius = 0.f; // rings are emitted this far out from their anchor, moving inward
+	int count = 0; // ring projectiles per run
+	std::vector<vec2> directions; // ring directions of every run, count per run, worked out once
+	STEER_MODE steer = STEER_MODE::FIXED;
+	float amount = 0.f; // health healed per run, or the factor of SCALE_SPEED
+};
+
+typedef std::vector<BossInstruction> BossPattern;
+
+// count projectiles around a ring starting at angle degrees, rotated by angle_step degrees every run.
+// A ring on the boss moves outward, a ring around the player inward.
+BossInstruction emitRing(BOSS_ANCHOR anchor, int count, float angle, float angle_step, float radius, float speed, int repeat, float interval_ms);
+// A pair of projectiles at offset +/- spread fired along direction, spread grows by spread_step every run
+BossInstruction emitLine(vec2 direction, vec2 offset, vec2 spread, vec2 spread_step, float speed, int repeat, float interval_ms);
+BossInstruction steerVolley(STEER_MODE mode, vec2 direction, float speed, float interval_ms);
+BossInstruction scaleVolley(float factor, float interval_ms);
+BossInstruction heal(float amount, int repeat, float interval_ms);
+BossInstruction clearProjectiles(float interval_ms);
+BossInstruction wait(float interval_ms);
+
+// Patterns a boss can run, see Boss::pattern
+extern const std::vector<BossPattern> BOSS_PATTERNS;
+
+struct ProjectileSpawn
+{
+	vec2 position;
+	vec2 velocity;
+};
+
+// Advance a boss's pattern. Projectiles it fires are appended to spawns for the caller to create
+// and add to the boss's volley, which is where steering and clearing act.
+void runBossPattern(Entity boss_entity, Boss& boss, vec2 player_pos, float elapsed_ms, std::vector<ProjectileSpawn>& spawns);
@@ -9,6 +9,7 @@
 #include <sstream>
 
 Debug debugging;
+PerfStats perf_stats;
 float death_timer_timer_ms = 3000;
 
 // Very, VERY simple OBJ loader from https://github.com/opengl-tutorials/ogl tutorial 7
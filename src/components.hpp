@@ -31,6 +31,11 @@ struct Enemy
 	float mana = 1.f;
 	ElementType type = ElementType::FIRE; // By default, an enemy is of fire type
 	float isAggravated = true;
+	// AI scheduling, see AISystem::step
+	float ai_elapsed_ms = 0.f; // since the enemy last ran its decisions
+	bool ai_deferred = false; // was due but did not fit in the AI budget
+	bool patrolling = false;
+	uint pool_slot = 0; // see EnemyPool, survival mode only
 };
 
 // hooded guy
@@ -49,9 +54,11 @@ struct LifeOrb {
 
 // Boss
 struct Boss {
-	int phase = 0;
-	int subphase = 0;
+	uint pattern = 0; // index into BOSS_PATTERNS
+	int phase = 0; // instruction of the pattern being run
+	int subphase = 0; // times that instruction has run
 	float phaseTimer = 250.f;
+	uint volley = 0; // group of every projectile the boss has fired, see ProjectileVolleys
 	Entity aura;
 };
 
@@ -88,6 +95,11 @@ struct Shadow
 	Entity owner;
 	bool active;
 	vec2 original_size;
+	// owner and light positions the shadow was last projected from, it is only redone when they change
+	bool projected = false;
+	vec2 owner_position;
+	vec2 owner_scale;
+	vec2 light_position;
 };
 
 // Exit door
@@ -101,6 +113,10 @@ struct Text
 {
 	std::string text;
 	vec3 color;
+	// Filled by the render system: the text the layout was made for, and its glyph quads as
+	// <vec2 pos, vec2 tex> per vertex, in unscaled font pixels from the text's position
+	std::string layout_text;
+	std::vector<vec4> layout;
 };
 
 // All data relevant to the resources of entities
@@ -160,6 +176,8 @@ struct Projectile
 	ElementType type;
 	bool hostile = false;
 	int bounces;
+	uint volley = 0; // group the projectile was fired in, 0 for none
+	uint pool_slot = 0; // see ProjectilePool
 };
 
 struct CharacterProjectileType
@@ -203,18 +221,6 @@ struct Direction {
 	DIRECTION direction;
 };
 
-// Stucture to store collision information
-struct Collision
-{
-	// Note, the first object is stored in the ECS container.entities
-	Entity other_entity; // the second object involved in the collision
-	vec2 displacement;
-	Collision(Entity& other_entity, vec2 displacement) { 
-		this->other_entity = other_entity;
-		this->displacement = displacement;
-	};
-};
-
 // Terrain
 struct Terrain
 {
@@ -237,6 +243,23 @@ struct Debug {
 };
 extern Debug debugging;
 
+// Per step cost of the game systems, shown in the window title in debug mode
+struct PerfStats
+{
+	uint ai_budget = 0; // most enemies that decide in one step
+	float ai_used_ms = 0.f;
+	uint ai_updated = 0; // enemies that ran their decisions
+	uint ai_deferred = 0; // enemies that were due but left for the next step
+	uint draw_calls = 0; // glDraw* calls issued by the last frame
+	uint sprite_batches = 0; // instanced draws of the sprite pass
+	uint batched_sprites = 0; // sprites drawn through those batches
+	uint render_drawn = 0; // renderables that passed culling in the last frame
+	uint render_culled = 0; // renderables left out for being off screen or in the dark
+	uint gl_state_issued = 0; // state changes sent to GL by the last frame
+	uint gl_state_elided = 0; // state changes skipped because the state was already current
+};
+extern PerfStats perf_stats;
+
 // Sets the brightness of the screen
 struct ScreenState
 {
@@ -428,6 +451,7 @@ enum class EFFECT_ASSET_ID {
 	TEXT_2D,
 	ANIMATED,
 	SHADOW,
+	SPRITE_BATCH,
 	EFFECT_COUNT
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
@@ -497,6 +521,8 @@ struct RenderRequest {
 	TEXTURE_ASSET_ID used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
 	EFFECT_ASSET_ID used_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
 	GEOMETRY_BUFFER_ID used_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+	int layer = 0; // lower layers are drawn first within their pass, from -128 to 127
+	uint queued_frame = 0; // set by the render system, the last frame it queued the entity in
 };
 
 // One for each sprite sheet to indicate the states
@@ -0,0 +1,60 @@
+// internal
+#include "contact_cache.hpp"
+
+// stlib
+#include <algorithm>
+
+ContactCache contacts;
+
+void ContactCache::begin_step()
+{
+	current.clear();
+}
+
+void ContactCache::add(Entity entity_i, Entity entity_j, vec2 displacement, vec2 normal)
+{
+	uint id_i = entity_i;
+	uint id_j = entity_j;
+	if (id_i > id_j) {
+		// store the pair from the point of view of the lower id
+		std::swap(entity_i, entity_j);
+		std::swap(id_i, id_j);
+		displacement = -displacement;
+		normal = -normal;
+	}
+	current.push_back({ entity_i, entity_j, ((uint64_t)id_i << 32) | id_j, displacement, normal });
+}
+
+void ContactCache::end_step()
+{
+	// stable so that the first report of a pair wins if it was added twice
+	std::stable_sort(current.begin(), current.end(),
+		[](const Contact& c1, const Contact& c2) { return c1.key < c2.key; });
+	current.erase(std::unique(current.begin(), current.end(),
+		[](const Contact& c1, const Contact& c2) { return c1.key == c2.key; }), current.end());
+
+	// both arrays are sorted, so one merge pass finds every transition
+	contact_events.clear();
+	uint i = 0, j = 0;
+	while (i < previous.size() || j < current.size()) {
+		if (j == current.size() || (i < previous.size() && previous[i].key < current[j].key)) {
+			contact_events.push_back({ CONTACT_PHASE::END, previous[i++] });
+		}
+		else if (i == previous.size() || current[j].key < previous[i].key) {
+			contact_events.push_back({ CONTACT_PHASE::BEGIN, current[j++] });
+		}
+		else {
+			contact_events.push_back({ CONTACT_PHASE::STAY, current[j++] });
+			i++;
+		}
+	}
+
+	previous.swap(current);
+}
+
+void ContactCache::clear()
+{
+	previous.clear();
+	current.clear();
+	contact_events.clear();
+}
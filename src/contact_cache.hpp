@@ -0,0 +1,57 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+// stlib
+#include <vector>
+#include <cstdint>
+
+// Transition of a contact pair reported by the cache each physics step
+enum class CONTACT_PHASE {
+	BEGIN = 0, // the pair started touching this step
+	STAY = BEGIN + 1, // the pair was already touching on the last step
+	END = STAY + 1 // the pair stopped touching, or one of the two entities was removed
+};
+
+// Two touching entities, stored once per pair with the lower entity id first
+struct Contact
+{
+	Entity entity_a;
+	Entity entity_b;
+	uint64_t key; // (a << 32) | b, used to sort and match pairs across steps
+	vec2 displacement; // pulls entity_a out of entity_b, entity_b gets the negated value
+	vec2 normal = { 0.f, 0.f }; // surface normal of entity_b, only set by swept collisions
+};
+
+struct ContactEvent
+{
+	CONTACT_PHASE phase;
+	Contact contact;
+};
+
+// Remembers which pairs touched on the previous physics step so gameplay can react to
+// begin/stay/end transitions instead of every overlap being reported from scratch.
+// Pairs are kept in flat arrays sorted by their key and diffed with a single merge.
+class ContactCache
+{
+public:
+	// Called by the physics system around its collision checks
+	void begin_step();
+	void add(Entity entity_i, Entity entity_j, vec2 displacement, vec2 normal = { 0.f, 0.f });
+	void end_step();
+
+	// Transitions found by the last end_step, ordered by pair key
+	const std::vector<ContactEvent>& events() const { return contact_events; }
+
+	// Forget every pair without reporting END, e.g. when the level is rebuilt
+	void clear();
+
+private:
+	std::vector<Contact> previous;
+	std::vector<Contact> current;
+	std::vector<ContactEvent> contact_events;
+};
+
+extern ContactCache contacts;
@@ -0,0 +1,140 @@
+// internal
+#include "danger_map.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using Clock = std::chrono::high_resolution_clock;
+
+DangerMap danger_map;
+
+constexpr float DangerMap::LOOKAHEAD_S;
+constexpr float DangerMap::DANGER_RADIUS;
+
+// Past this many cells per axis the cells are made bigger instead
+const int MAX_FIELD_DIM = 256;
+
+void DangerMap::build(float min_cell_size)
+{
+	auto build_start = Clock::now();
+	if (registry.enemies.size() == 0) {
+		dims = { 0, 0 };
+		last_build_ms = 0.f;
+		return;
+	}
+
+	// only the area enemies can be in matters
+	vec2 field_min = vec2(std::numeric_limits<float>::max());
+	vec2 field_max = vec2(-std::numeric_limits<float>::max());
+	for (Entity entity : registry.enemies.entities) {
+		vec2 position = registry.positions.get(entity).position;
+		field_min = min(field_min, position);
+		field_max = max(field_max, position);
+	}
+	origin = field_min - DANGER_RADIUS;
+	vec2 extent = field_max - field_min + 2.f * DANGER_RADIUS;
+	cell_size = std::max(min_cell_size, std::max(extent.x, extent.y) / MAX_FIELD_DIM);
+	dims = min(ivec2(extent / cell_size) + 1, ivec2(MAX_FIELD_DIM));
+
+	// triangular falloff to the side of a path, scaled so that after blurring along and across
+	// a path the danger on it is the weight it was drawn with
+	radius = (int)ceil(DANGER_RADIUS / cell_size);
+	kernel.resize(2 * radius + 1);
+	for (int k = -radius; k <= radius; k++)
+		kernel[k + radius] = (1.f - (float)abs(k) / (radius + 1)) / sqrt((float)(radius + 1));
+
+	stride = dims.x + 2 * radius;
+	size_t field_size = (size_t)stride * (dims.y + 2 * radius);
+	field_danger.assign(field_size, 0.f);
+	field_flow_x.assign(field_size, 0.f);
+	field_flow_y.assign(field_size, 0.f);
+
+	// draw where each player projectile will be over the lookahead, sooner is more dangerous
+	for (uint i = 0; i < registry.projectiles.size(); i++) {
+		if (registry.projectiles.components[i].hostile) continue;
+		Entity entity = registry.projectiles.entities[i];
+		if (!registry.velocities.has(entity)) continue;
+		vec2 position = registry.positions.get(entity).position;
+		vec2 velocity = registry.velocities.get(entity).velocity;
+		float speed = length(velocity);
+		vec2 dir = (speed > 0.f) ? velocity / speed : vec2(0.f, 0.f);
+		float reach = speed * LOOKAHEAD_S;
+		int steps = (int)(reach / cell_size) + 1;
+		for (int s = 0; s <= steps; s++) {
+			int index = fieldIndex(position + dir * (reach * s / steps));
+			if (index < 0) continue;
+			float weight = 1.f - (float)s / (steps + 1);
+			field_danger[index] += weight;
+			field_flow_x[index] += dir.x * weight;
+			field_flow_y[index] += dir.y * weight;
+		}
+	}
+
+	blur(field_danger);
+	blur(field_flow_x);
+	blur(field_flow_y);
+
+	last_build_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - build_start)).count() / 1000;
+}
+
+// Separable blur with the kernel, rows then columns. Both inner loops run over contiguous
+// cells without branches so they vectorize, the padding keeps every read inside the field.
+void DangerMap::blur(std::vector<float>& field)
+{
+	scratch.assign(field.size(), 0.f);
+	for (int y = radius; y < dims.y + radius; y++) {
+		float* out = scratch.data() + (size_t)y * stride;
+		const float* in = field.data() + (size_t)y * stride;
+		for (int k = -radius; k <= radius; k++) {
+			float w = kernel[k + radius];
+			for (int x = radius; x < dims.x + radius; x++)
+				out[x] += w * in[x + k];
+		}
+	}
+	for (int y = radius; y < dims.y + radius; y++) {
+		float* out = field.data() + (size_t)y * stride;
+		std::fill(out + radius, out + radius + dims.x, 0.f);
+		for (int k = -radius; k <= radius; k++) {
+			float w = kernel[k + radius];
+			const float* in = scratch.data() + (size_t)(y + k) * stride;
+			for (int x = radius; x < dims.x + radius; x++)
+				out[x] += w * in[x];
+		}
+	}
+}
+
+// Index of the cell holding the position in the padded fields, -1 outside of the field
+int DangerMap::fieldIndex(vec2 position) const
+{
+	ivec2 cell = ivec2(floor((position - origin) / cell_size));
+	if (cell.x < 0 || cell.y < 0 || cell.x >= dims.x || cell.y >= dims.y) return -1;
+	return (cell.y + radius) * stride + cell.x + radius;
+}
+
+float DangerMap::danger(vec2 position) const
+{
+	int index = fieldIndex(position);
+	return (index < 0) ? 0.f : field_danger[index];
+}
+
+vec2 DangerMap::dodge_direction(vec2 position, uint tie_break) const
+{
+	int index = fieldIndex(position);
+	if (index < 0) return { 0.f, 0.f };
+
+	// downhill in the danger field, the padding makes the neighbours always valid
+	vec2 downhill = { field_danger[index - 1] - field_danger[index + 1], field_danger[index - stride] - field_danger[index + stride] };
+	vec2 flow = { field_flow_x[index], field_flow_y[index] };
+	if (length(flow) == 0.f) {
+		return (length(downhill) > 0.f) ? normalize(downhill) : vec2(0.f, 0.f);
+	}
+
+	// step sideways off the paths rather than downhill, which would be running ahead of the projectiles
+	vec2 side = normalize(vec2(-flow.y, flow.x));
+	float across = dot(downhill, side);
+	if (across < 0.f || (across == 0.f && tie_break % 2 == 1)) side = -side;
+	return side;
+}
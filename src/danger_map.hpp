@@ -0,0 +1,50 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <vector>
+
+// Coarse field of how dangerous each spot is for enemies, rebuilt every AI step by drawing
+// each player projectile's path over the next LOOKAHEAD_S seconds and blurring it.
+// Enemies read the danger and a dodge direction at their own position in O(1) instead of
+// looking at projectiles.
+class DangerMap
+{
+public:
+	static constexpr float LOOKAHEAD_S = 0.5f;
+	static constexpr float DANGER_RADIUS = 100.f; // how far to the side of a path the danger spreads
+
+	// Rebuild the field over the area around all enemies, cells are at least cell_size px wide
+	void build(float cell_size);
+
+	// Danger at a position, 0 outside of the field
+	float danger(vec2 position) const;
+	// Unit direction across the projectile paths at a position, away from the closest one.
+	// Enemies standing right on a path break the tie with their entity id.
+	vec2 dodge_direction(vec2 position, uint tie_break) const;
+
+	ivec2 size() const { return dims; }
+	float cell() const { return cell_size; }
+	float build_ms() const { return last_build_ms; }
+
+private:
+	int fieldIndex(vec2 position) const;
+	void blur(std::vector<float>& field);
+
+	float cell_size = 32.f;
+	vec2 origin = { 0.f, 0.f };
+	ivec2 dims = { 0, 0 };
+	int radius = 0; // blur radius in cells, the fields have this many empty cells of padding on every side
+	int stride = 0;
+	float last_build_ms = 0.f;
+
+	std::vector<float> kernel;
+	std::vector<float> field_danger;
+	std::vector<float> field_flow_x; // projectile travel direction weighted by danger
+	std::vector<float> field_flow_y;
+	std::vector<float> scratch;
+};
+
+extern DangerMap danger_map;
@@ -0,0 +1,142 @@
+// internal
+#include "flow_field.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using Clock = std::chrono::high_resolution_clock;
+
+FlowField flow_field;
+
+constexpr float FlowField::CELL_SIZE;
+constexpr float FlowField::AGENT_RADIUS;
+
+const uint UNREACHABLE = std::numeric_limits<uint>::max();
+
+// the 8 neighbours of a cell and the cost of stepping to them, diagonals are about sqrt(2) longer
+const int NEIGHBOUR_X[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+const int NEIGHBOUR_Y[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+const uint NEIGHBOUR_COST[8] = { 10, 10, 10, 10, 14, 14, 14, 14 };
+const uint NUM_BUCKETS = 15;
+const float DIAGONAL = 0.70710678f;
+const vec2 NEIGHBOUR_DIR[8] = { { 1.f, 0.f }, { -1.f, 0.f }, { 0.f, 1.f }, { 0.f, -1.f },
+	{ DIAGONAL, DIAGONAL }, { DIAGONAL, -DIAGONAL }, { -DIAGONAL, DIAGONAL }, { -DIAGONAL, -DIAGONAL } };
+
+void FlowField::bake(const std::vector<std::pair<vec4, Terrain>>& terrains)
+{
+	target_cell = -1;
+	dims = { 0, 0 };
+	if (terrains.size() == 0) return;
+
+	// terrain is given as top left corner and size
+	vec2 level_min = vec2(std::numeric_limits<float>::max());
+	vec2 level_max = vec2(-std::numeric_limits<float>::max());
+	for (const std::pair<vec4, Terrain>& terrain : terrains) {
+		level_min = min(level_min, vec2(terrain.first.x, terrain.first.y));
+		level_max = max(level_max, vec2(terrain.first.x + terrain.first.z, terrain.first.y + terrain.first.w));
+	}
+	origin = level_min;
+	dims = ivec2(ceil((level_max - level_min) / CELL_SIZE));
+
+	blocked.assign(dims.x * dims.y, 0);
+	for (const std::pair<vec4, Terrain>& terrain : terrains) {
+		if (terrain.second.moveable) continue;
+		vec2 terrain_min = vec2(terrain.first.x, terrain.first.y) - AGENT_RADIUS;
+		vec2 terrain_max = vec2(terrain.first.x + terrain.first.z, terrain.first.y + terrain.first.w) + AGENT_RADIUS;
+		// every cell whose centre is covered by the grown terrain
+		ivec2 cell_min = max(ivec2(ceil((terrain_min - origin) / CELL_SIZE - 0.5f)), ivec2(0));
+		ivec2 cell_max = min(ivec2(floor((terrain_max - origin) / CELL_SIZE - 0.5f)), dims - 1);
+		for (int y = cell_min.y; y <= cell_max.y; y++)
+			for (int x = cell_min.x; x <= cell_max.x; x++)
+				blocked[y * dims.x + x] = 1;
+	}
+
+	cost.assign(dims.x * dims.y, UNREACHABLE);
+	directions.assign(dims.x * dims.y, vec2(0.f, 0.f));
+	open.resize(NUM_BUCKETS);
+}
+
+int FlowField::cellIndex(vec2 position) const
+{
+	ivec2 cell = ivec2(floor((position - origin) / CELL_SIZE));
+	if (cell.x < 0 || cell.y < 0 || cell.x >= dims.x || cell.y >= dims.y) return -1;
+	return cell.y * dims.x + cell.x;
+}
+
+void FlowField::update(vec2 target)
+{
+	int cell = cellIndex(target);
+	if (cell == target_cell) return;
+	target_cell = cell;
+	if (cell < 0) {
+		std::fill(directions.begin(), directions.end(), vec2(0.f, 0.f));
+		return;
+	}
+	auto update_start = Clock::now();
+
+	// Dijkstra out from the target over walkable cells, the target's own cell is always a start
+	// even if the player is pressed against a wall. Steps cost at most 14 so every open cell is
+	// within 15 of the cheapest one, and a ring of buckets can stand in for the priority queue.
+	std::fill(cost.begin(), cost.end(), UNREACHABLE);
+	for (std::vector<int>& bucket : open)
+		bucket.clear();
+	cost[cell] = 0;
+	open[0].push_back(cell);
+	uint num_open = 1;
+	for (uint current_cost = 0; num_open > 0; current_cost++) {
+		std::vector<int>& bucket = open[current_cost % NUM_BUCKETS];
+		while (bucket.size() > 0) {
+			int current = bucket.back();
+			bucket.pop_back();
+			num_open--;
+			if (cost[current] != current_cost) continue; // already reached more cheaply
+			int x = current % dims.x;
+			int y = current / dims.x;
+			for (int n = 0; n < 8; n++) {
+				int nx = x + NEIGHBOUR_X[n];
+				int ny = y + NEIGHBOUR_Y[n];
+				if (nx < 0 || ny < 0 || nx >= dims.x || ny >= dims.y) continue;
+				int next = ny * dims.x + nx;
+				if (blocked[next]) continue;
+				// no cutting diagonally past a blocked corner
+				if (n >= 4 && (blocked[y * dims.x + nx] || blocked[ny * dims.x + x])) continue;
+				uint next_cost = current_cost + NEIGHBOUR_COST[n];
+				if (next_cost >= cost[next]) continue;
+				cost[next] = next_cost;
+				open[next_cost % NUM_BUCKETS].push_back(next);
+				num_open++;
+			}
+		}
+	}
+
+	// each cell points at its cheapest neighbour, blocked cells too so that an enemy that
+	// was pushed into the grown terrain is led back out of it
+	for (int y = 0; y < dims.y; y++) {
+		for (int x = 0; x < dims.x; x++) {
+			int index = y * dims.x + x;
+			uint best = cost[index];
+			vec2 best_dir = { 0.f, 0.f };
+			for (int n = 0; n < 8; n++) {
+				int nx = x + NEIGHBOUR_X[n];
+				int ny = y + NEIGHBOUR_Y[n];
+				if (nx < 0 || ny < 0 || nx >= dims.x || ny >= dims.y) continue;
+				if (n >= 4 && (blocked[y * dims.x + nx] || blocked[ny * dims.x + x])) continue;
+				if (cost[ny * dims.x + nx] < best) {
+					best = cost[ny * dims.x + nx];
+					best_dir = NEIGHBOUR_DIR[n];
+				}
+			}
+			directions[index] = best_dir;
+		}
+	}
+
+	last_update_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - update_start)).count() / 1000;
+}
+
+vec2 FlowField::direction(vec2 position) const
+{
+	int cell = cellIndex(position);
+	return (cell < 0) ? vec2(0.f, 0.f) : directions[cell];
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+
+// stlib
+#include <vector>
+#include <utility>
+
+// Shared path to the player for every enemy. The level's static terrain is baked into a grid
+// of walkable cells once per level, then a single Dijkstra pass from the player's cell gives
+// each cell the direction to walk in. Enemies look their direction up in O(1), so the cost
+// does not grow with the number of enemies.
+class FlowField
+{
+public:
+	static constexpr float CELL_SIZE = 25.f;
+	static constexpr float AGENT_RADIUS = 25.f; // terrain is grown by this much so enemies do not clip corners
+
+	// Bake the walkable cells from the level's terrain, moveable terrain is ignored
+	void bake(const std::vector<std::pair<vec4, Terrain>>& terrains);
+
+	// Recompute the field toward target, only does any work when target is in a new cell
+	void update(vec2 target);
+
+	// Unit direction to walk from position toward the target, 0 if there is no path
+	vec2 direction(vec2 position) const;
+
+	ivec2 size() const { return dims; }
+	float update_ms() const { return last_update_ms; }
+
+private:
+	int cellIndex(vec2 position) const;
+
+	vec2 origin = { 0.f, 0.f };
+	ivec2 dims = { 0, 0 };
+	int target_cell = -1;
+	float last_update_ms = 0.f;
+
+	std::vector<unsigned char> blocked;
+	std::vector<uint> cost; // to the target, in tenths of a cell
+	std::vector<vec2> directions;
+	std::vector<std::vector<int>> open; // cells waiting to be visited, bucketed by cost
+};
+
+extern FlowField flow_field;
@@ -1,5 +1,5 @@
 #include "game_level.hpp" 
-#include <random>
+#include "rng.hpp"
 #include <tiny_ecs_registry.hpp>
 
 /*
@@ -25,21 +25,13 @@
 const Enemy& getRandomNormalEnemy() {
 	static const std::vector<Enemy> normalEnemies = { WATER_NORMAL, FIRE_NORMAL, EARTH_NORMAL, LIGHTNING_NORMAL };
 
-	// Use C++11 random number generation
-	static std::random_device rd;
-	static std::mt19937 gen(rd());
-	std::uniform_int_distribution<int> distribution(0, normalEnemies.size() - 1);
-
-	return normalEnemies[distribution(gen)];
+	return normalEnemies[rng.stream(RNG_LEVEL).below((uint)normalEnemies.size())];
 }
 
 const double getRandomSpeed() {
-	static std::random_device rd;
-	static std::mt19937 gen(rd());
-	std::uniform_real_distribution<double> distribution(75, 100);
-	std::uniform_int_distribution<int> int_distribution(0, 1);
-
-	return distribution(gen) * (int_distribution(gen) * 2 - 1);
+	Pcg32& gen = rng.stream(RNG_LEVEL);
+	double speed = gen.uniform(75.f, 100.f);
+	return speed * ((int)gen.below(2) * 2 - 1);
 }
 
 bool GameLevel::init(uint level) {
@@ -746,6 +738,19 @@ bool GameLevel::init(uint level) {
 		terrains.push_back(std::make_pair(vec4(1325, 0, default_side_width, 700), SIDE_STATIONARY));
 		break;
 
+	case SURVIVAL:
+		// boss arena without a boss, the enemies come from SurvivalMode
+		floors.push_back(vec4(25, 25, 2700, 1375));
+
+		this->player_starting_pos = vec2(1375, 700);
+		this->exit_door_pos = NULL_POS;
+
+		terrains.push_back(std::make_pair(vec4(25, 0, 2700, default_north_height), NORTH_STATIONARY));
+		terrains.push_back(std::make_pair(vec4(25, 1375, 2700, default_south_height), SOUTH_STATIONARY));
+		terrains.push_back(std::make_pair(vec4(0, 0, default_side_width, 1400), SIDE_STATIONARY));
+		terrains.push_back(std::make_pair(vec4(2725, 0, default_side_width, 1400), SIDE_STATIONARY));
+		break;
+
 	default:
 		printf("no level provided\n");
 		break;
@@ -36,7 +36,8 @@ enum Level {
 	FINAL_BOSS = CUTSCENE_5 + 1,
 	CUTSCENE_6 = FINAL_BOSS + 1,
 	THE_END = CUTSCENE_6 + 1,
-	POWER_UP = THE_END + 1
+	POWER_UP = THE_END + 1,
+	SURVIVAL = POWER_UP + 1 // endless waves in the boss arena, only reached from the main menu
 };
 
 //Enemy types to re-use later
@@ -0,0 +1,84 @@
+// internal
+#include "gl_state_cache.hpp"
+
+void GLStateCache::invalidate()
+{
+	program_known = false;
+	vertex_array_known = false;
+	array_buffer_known = false;
+	uniform_buffer_known = false;
+	active_unit_known = false;
+	for (bool& known : textures_known) known = false;
+	blend_known = false;
+	blend_func_known = false;
+	viewport_known = false;
+}
+
+template <typename T>
+bool GLStateCache::change(T& current, const T& value, bool& known)
+{
+	if (known && current == value) {
+		num_elided++;
+		return false;
+	}
+	current = value;
+	known = true;
+	num_issued++;
+	return true;
+}
+
+void GLStateCache::useProgram(GLuint value)
+{
+	if (change(program, value, program_known))
+		glUseProgram(value);
+}
+
+void GLStateCache::bindVertexArray(GLuint value)
+{
+	if (change(vertex_array, value, vertex_array_known))
+		glBindVertexArray(value);
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint value)
+{
+	bool needed = true;
+	if (target == GL_ARRAY_BUFFER) needed = change(array_buffer, value, array_buffer_known);
+	else if (target == GL_UNIFORM_BUFFER) needed = change(uniform_buffer, value, uniform_buffer_known);
+	else num_issued++;
+	if (needed)
+		glBindBuffer(target, value);
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLuint value)
+{
+	assert(unit < GL_STATE_TEXTURE_UNITS);
+	// the active unit only matters when the binding itself changes
+	if (textures_known[unit] && textures[unit] == value) {
+		num_elided++;
+		return;
+	}
+	if (change(active_unit, unit, active_unit_known))
+		glActiveTexture(GL_TEXTURE0 + unit);
+	change(textures[unit], value, textures_known[unit]);
+	glBindTexture(GL_TEXTURE_2D, value);
+}
+
+void GLStateCache::setBlend(bool value)
+{
+	if (change(blend, value, blend_known)) {
+		if (value) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+	}
+}
+
+void GLStateCache::blendFunc(GLenum src, GLenum dst)
+{
+	if (change(blend_func, ivec2(src, dst), blend_func_known))
+		glBlendFunc(src, dst);
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (change(viewport_rect, ivec4(x, y, width, height), viewport_known))
+		glViewport(x, y, width, height);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// Texture units the cache follows, the renderer only samples from unit 0
+const uint GL_STATE_TEXTURE_UNITS = 4;
+
+// Mirrors the GL state the renderer changes most and skips the calls that would not change it.
+// Anything that changes this state behind the cache's back (initialization, ImGui) has to be
+// followed by invalidate(), after which the next call of each kind is always issued.
+class GLStateCache
+{
+public:
+	void invalidate();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertex_array);
+	// Only GL_ARRAY_BUFFER and GL_UNIFORM_BUFFER are cached, element buffers belong to the vertex array
+	void bindBuffer(GLenum target, GLuint buffer);
+	// Binds a GL_TEXTURE_2D to the unit, switching the active unit only when needed
+	void bindTexture(GLuint unit, GLuint texture);
+	void setBlend(bool enabled);
+	void blendFunc(GLenum src, GLenum dst);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	// State changes sent to GL and skipped since the last reset
+	uint issued() const { return num_issued; }
+	uint elided() const { return num_elided; }
+	void resetCounters() { num_issued = 0; num_elided = 0; }
+
+private:
+	// Records whether the call is needed, updating the cached value if it is
+	template <typename T>
+	bool change(T& current, const T& value, bool& known);
+
+	GLuint program;
+	GLuint vertex_array;
+	GLuint array_buffer;
+	GLuint uniform_buffer;
+	GLuint active_unit;
+	GLuint textures[GL_STATE_TEXTURE_UNITS];
+	bool blend;
+	ivec2 blend_func;
+	ivec4 viewport_rect;
+
+	bool program_known = false;
+	bool vertex_array_known = false;
+	bool array_buffer_known = false;
+	bool uniform_buffer_known = false;
+	bool active_unit_known = false;
+	bool textures_known[GL_STATE_TEXTURE_UNITS] = {};
+	bool blend_known = false;
+	bool blend_func_known = false;
+	bool viewport_known = false;
+
+	uint num_issued = 0;
+	uint num_elided = 0;
+};
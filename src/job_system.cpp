@@ -0,0 +1,71 @@
+// internal
+#include "job_system.hpp"
+
+JobSystem jobs;
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	job_ready.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void JobSystem::start(unsigned int num_threads)
+{
+	assert(workers.empty());
+	for (unsigned int w = 1; w < num_threads; w++)
+		workers.emplace_back(&JobSystem::workerLoop, this, w);
+}
+
+void JobSystem::runRange(unsigned int worker)
+{
+	unsigned int begin = (unsigned int)((unsigned long long)job_count * worker / thread_count());
+	unsigned int end = (unsigned int)((unsigned long long)job_count * (worker + 1) / thread_count());
+	if (begin < end) (*current_job)(begin, end, worker);
+}
+
+void JobSystem::workerLoop(unsigned int worker)
+{
+	unsigned int seen_generation = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			job_ready.wait(lock, [&] { return quitting || generation != seen_generation; });
+			if (quitting) return;
+			seen_generation = generation;
+		}
+
+		runRange(worker);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--pending == 0) job_done.notify_one();
+	}
+}
+
+void JobSystem::parallel_for(unsigned int count, unsigned int min_parallel,
+	const std::function<void(unsigned int begin, unsigned int end, unsigned int worker)>& job)
+{
+	if (workers.empty() || count < min_parallel) {
+		if (count > 0) job(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_job = &job;
+		job_count = count;
+		pending = (unsigned int)workers.size();
+		generation++;
+	}
+	job_ready.notify_all();
+
+	runRange(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	job_done.wait(lock, [&] { return pending == 0; });
+	current_job = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// stlib
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cassert>
+
+// A small pool of persistent worker threads for splitting loops across cores.
+// The calling thread always takes part as worker 0, so with one thread nothing is spawned.
+class JobSystem
+{
+public:
+	~JobSystem();
+
+	// Spawns num_threads - 1 workers, call once before the first parallel_for
+	void start(unsigned int num_threads);
+	unsigned int thread_count() const { return (unsigned int)workers.size() + 1; }
+
+	// Splits [0, count) into one contiguous range per thread and blocks until all of them are done.
+	// The split only depends on count and the thread count, so the same input always gets the
+	// same ranges. Loops shorter than min_parallel run on the calling thread alone.
+	void parallel_for(unsigned int count, unsigned int min_parallel,
+		const std::function<void(unsigned int begin, unsigned int end, unsigned int worker)>& job);
+
+private:
+	void workerLoop(unsigned int worker);
+	void runRange(unsigned int worker);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable job_ready;
+	std::condition_variable job_done;
+
+	const std::function<void(unsigned int, unsigned int, unsigned int)>* current_job = nullptr;
+	unsigned int job_count = 0;
+	unsigned int generation = 0; // bumped for every parallel_for so workers know there is new work
+	unsigned int pending = 0; // workers that have not finished the current job
+	bool quitting = false;
+};
+
+extern JobSystem jobs;
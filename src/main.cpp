@@ -3,6 +3,10 @@
 
 // stlib
 #include <chrono>
+#include <algorithm>
+#include <thread>
+#include <random>
+#include <cstdlib>
 
 // internal
 #include "physics_system.hpp"
@@ -10,12 +14,24 @@
 #include "world_system.hpp"
 #include "ai_system.hpp"
 #include "ui_system.hpp"
+#include "job_system.hpp"
+#include "rng.hpp"
+#include "survival_mode.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
 // Entry point
 int main()
 {
+	// every random number in a session comes from this seed, set ARIA_SEED to replay one
+	const char* seed_env = std::getenv("ARIA_SEED");
+	uint64_t seed = seed_env ? std::strtoull(seed_env, nullptr, 10) : std::random_device()();
+	rng.seed(seed);
+	printf("Random seed: %llu\n", (unsigned long long)seed);
+
+	// set ARIA_DEBUG to start in debug mode, with the performance counters in the title, F3 toggles it
+	debugging.in_debug_mode = std::getenv("ARIA_DEBUG") != nullptr;
+
 	// Global systems
 	WorldSystem world_system;
 	RenderSystem render_system;
@@ -34,6 +50,9 @@ int main()
 		return EXIT_FAILURE;
 	}
 
+	// worker threads for collision detection, hardware_concurrency can report 0 when unknown
+	jobs.start(std::max(1u, std::min(std::thread::hardware_concurrency(), 16u)));
+
 	// initialize the render system
 	render_system.init(window);
 
@@ -45,7 +64,11 @@ int main()
 	world_system.init(&render_system, curr_level);
 	ai_system.init(&render_system);
 
-	// variable timestep loop
+	// fixed timestep loop: the simulation advances in whole ticks of TICK_MS regardless of the
+	// display's frame rate, and the renderer interpolates between the last two ticks
+	const float TICK_MS = 1000.f / 120.f;
+	const int MAX_TICKS_PER_FRAME = 12; // ~100 ms of simulation, anything beyond that is dropped
+	float accumulator_ms = 0.f;
 	auto t = Clock::now();
 	while (!world_system.is_over()) {
 		// Processes system messages, if this wasn't present the window would become unresponsive
@@ -58,18 +81,24 @@ int main()
 		auto now = Clock::now();
 		float elapsed_ms =
 			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
-		if (elapsed_ms > 100) elapsed_ms = 100; // guarantee at least 10 ticks per second
 		t = now;
 
 		// handles what UI elements to show
 		ui_system->showWindows();
 		//ImGui::ShowDemoWindow();
 
-		if (ui_system->getState() == NEW_GAME || ui_system->getState() == PLAY_GAME) {
+		if (ui_system->getState() == NEW_GAME || ui_system->getState() == NEW_SURVIVAL || ui_system->getState() == PLAY_GAME) {
 			if (ui_system->getState() == NEW_GAME) {
 				world_system.new_game();
 				ui_system->setState(PLAY_GAME);
+				accumulator_ms = 0.f;
 			}
+			else if (ui_system->getState() == NEW_SURVIVAL) {
+				world_system.new_survival();
+				ui_system->setState(PLAY_GAME);
+				accumulator_ms = 0.f;
+			}
+			survival.record_frame(elapsed_ms);
 
 			curr_level = world_system.getLevel();
 			if (curr_level.curr_level == TUTORIAL) {
@@ -78,12 +107,22 @@ int main()
 			else {
 				ui_system->setTutorialFlag(false);
 			}
-			world_system.step(elapsed_ms);
-			physics_system.step(elapsed_ms);
-			ai_system.step(elapsed_ms);
-			world_system.step(elapsed_ms);
 
-			world_system.handle_collisions();
+			// time only builds up while playing, so nothing is replayed after leaving a menu
+			accumulator_ms += elapsed_ms;
+			int ticks = 0;
+			while (accumulator_ms >= TICK_MS && ticks < MAX_TICKS_PER_FRAME) {
+				world_system.step(TICK_MS);
+				physics_system.step(TICK_MS);
+				ai_system.step(TICK_MS);
+				world_system.handle_collisions();
+
+				accumulator_ms -= TICK_MS;
+				ticks++;
+			}
+			// too far behind to catch up, drop the backlog instead of spiralling
+			if (ticks == MAX_TICKS_PER_FRAME) accumulator_ms = std::min(accumulator_ms, TICK_MS);
+			world_system.update_title();
 		}
 
 		if (ui_system->getState() == QUIT) {
@@ -91,7 +130,7 @@ int main()
 		}
 
 		render_system.animation_step(elapsed_ms);
-		render_system.draw();
+		render_system.draw(accumulator_ms / TICK_MS);
 	}
 
 	return EXIT_SUCCESS;
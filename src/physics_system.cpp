@@ -1,6 +1,12 @@
 // internal
 #include "physics_system.hpp"
 #include "world_init.hpp"
+#include "contact_cache.hpp"
+#include "spatial_grid.hpp"
+#include "job_system.hpp"
+#include "projectile_pool.hpp"
+// stlib
+#include <limits>
 
 // Returns the local bounding coordinates scaled by the current size of the entity
 vec2 get_bounding_box(const Position& position)
@@ -26,30 +32,32 @@ bool circleCollides(const Position& position1, const Position& position2)
 	return false;
 }
 
-vec2 worldTransform(vec2 coords, Position& position) {
+vec2 worldTransform(vec2 coords, const Position& position) {
 	// !!! TODO: add rotation
 	return vec2(coords.x * position.scale.x + position.position.x, coords.y * position.scale.y + position.position.y);
 }
 
 // Reference: 
 // https://github.com/OneLoneCoder/Javidx9/blob/master/PixelGameEngine/SmallerProjects/OneLoneCoder_PGE_PolygonCollisions1.cpp?fbclid=IwAR1e0EyRPtFFGmg1EuiiKU9JxBwOAFN42YA3LIvfm0GHspBbE1df43ZeCz8
-void diagonalCollides(Entity& ent_i, Entity& ent_j)
+// Only reads the snapshot of the two bodies so it can run on any worker thread. Returns true on a
+// collision, with the displacement that pulls body_a back out of body_b.
+bool diagonalCollides(const NarrowBody& body_a, const NarrowBody& body_b, vec2& displacement_a)
 {
-	Entity* entity_i = &ent_i;
-	Entity* entity_j = &ent_j;
+	const NarrowBody* body_i = &body_a;
+	const NarrowBody* body_j = &body_b;
 	bool flag = false;
 
 	for (int obj = 0; obj < 2; obj++) {
 		if (obj == 1) {
-			entity_i = &ent_j;
-			entity_j = &ent_i;
+			body_i = &body_b;
+			body_j = &body_a;
 		}
-		std::vector<ColoredVertex> i_vertices = registry.meshPtrs.get(*entity_i)->vertices;
-		std::vector<ColoredVertex> j_vertices = registry.meshPtrs.get(*entity_j)->vertices;
+		const std::vector<ColoredVertex>& i_vertices = body_i->mesh->vertices;
+		const std::vector<ColoredVertex>& j_vertices = body_j->mesh->vertices;
 		// figure how to get vertices of things also made for textures
 
-		Position& position_i = registry.positions.get(*entity_i);
-		Position& position_j = registry.positions.get(*entity_j);
+		const Position& position_i = body_i->position;
+		const Position& position_j = body_j->position;
 
 		for (uint i = 0; i < i_vertices.size(); i++)
 		{
@@ -76,104 +84,260 @@ void diagonalCollides(Entity& ent_i, Entity& ent_j)
 				}
 			}
 			if (flag) {
-				// ent_i is obj = 0 meaning it penetrated ent_j, so displacement is negative so we pull back ent_i's position
-				registry.collisions.emplace_with_duplicates(ent_i, ent_j, (obj == 0) ? -displacement : displacement);
-				// ent_j is obj = 0 meaning it penetrated ent_i, so displacement is positive to push away ent_i
-				registry.collisions.emplace_with_duplicates(ent_j, ent_i, (obj == 0) ? displacement : -displacement);
-				return;
+				// body_a is obj = 0 meaning it penetrated body_b, so displacement is negative so we pull back body_a's position
+				displacement_a = (obj == 0) ? -displacement : displacement;
+				return true;
 			}
 		}
 	}
-	return;
+	return false;
 }
 
-// Function that checks if two entities collides using an axis-aligned bounding-box implementation.
-// If there is a collision between two entities, add a Collision component to the Component container
-// marking both entities involved in the collision and the direction which entity i hit entity j from.
-bool AABBCollides(Entity& entity_i, Entity& entity_j)
+// Shouldn't care if terrain-terrain and exitDoor-terrain collisions happen
+bool shouldIgnoreCollision(const NarrowBody& body_i, const NarrowBody& body_j) 
 {
-	auto& position_container = registry.positions;
-	Position& position_i = position_container.get(entity_i);
-	Position& position_j = position_container.get(entity_j);
-
-	float i_left = position_i.position.x - abs(position_i.scale.x) / 2;
-	float i_right = position_i.position.x + abs(position_i.scale.x) / 2;
-	float i_top = position_i.position.y - abs(position_i.scale.y) / 2;
-	float i_bottom = position_i.position.y + abs(position_i.scale.y) / 2;
-	float j_left = position_j.position.x - abs(position_j.scale.x) / 2;
-	float j_right = position_j.position.x + abs(position_j.scale.x) / 2;
-	float j_top = position_j.position.y - abs(position_j.scale.y) / 2;
-	float j_bottom = position_j.position.y + abs(position_j.scale.y) / 2;
-
-	if (i_left <= j_right && i_right >= j_left && i_bottom >= j_top && i_top <= j_bottom)
-	{
+	if (body_i.terrain && body_j.terrain) {
+		if (body_i.moveable || body_j.moveable) {
+			return false;
+		}
+		return true;
+	}
+	if ((body_i.terrain && body_j.exit_door) || (body_i.exit_door && body_j.terrain)) {
 		return true;
 	}
 	return false;
 }
 
-// Shouldn't care if terrain-terrain and exitDoor-terrain collisions happen
-bool shouldIgnoreCollision(Entity& entity_i, Entity& entity_j) 
+// Swept AABB test of a box with half size 'half' moving from 'start' by 'delta' against a static box.
+// The static box is grown by the moving box (Minkowski sum) so the test becomes a ray against a box.
+// Returns true if the boxes start apart and touch within this step, along with the time of impact
+// in [0, 1] and the normal of the face that was hit.
+bool sweptAABB(vec2 start, vec2 delta, vec2 half, vec2 other_center, vec2 other_half, float& toi, vec2& normal)
 {
-	if (registry.terrain.has(entity_i) && registry.terrain.has(entity_j)) {
-		if (registry.terrain.get(entity_i).moveable || registry.terrain.get(entity_j).moveable) {
-			return false;
+	vec2 box_min = other_center - (other_half + half);
+	vec2 box_max = other_center + (other_half + half);
+	float t_enter = -std::numeric_limits<float>::infinity();
+	float t_exit = std::numeric_limits<float>::infinity();
+	int enter_axis = -1;
+
+	for (int axis = 0; axis < 2; axis++) {
+		if (delta[axis] == 0.f) {
+			// not moving on this axis, so it has to already lie within the slab
+			if (start[axis] <= box_min[axis] || start[axis] >= box_max[axis]) return false;
+			continue;
 		}
-		return true;
+		float t1 = (box_min[axis] - start[axis]) / delta[axis];
+		float t2 = (box_max[axis] - start[axis]) / delta[axis];
+		if (t1 > t2) std::swap(t1, t2);
+		if (t1 > t_enter) {
+			t_enter = t1;
+			enter_axis = axis;
+		}
+		t_exit = std::min(t_exit, t2);
 	}
-	if ((registry.terrain.has(entity_i) && registry.exitDoors.has(entity_j)) ||
-		(registry.exitDoors.has(entity_i) && registry.terrain.has(entity_j))) {
-		return true;
+
+	// t_enter < 0 means the boxes were already overlapping, which the discrete check handles
+	if (enter_axis < 0 || t_enter > t_exit || t_enter < 0.f || t_enter > 1.f) return false;
+
+	toi = t_enter;
+	normal = { 0.f, 0.f };
+	normal[enter_axis] = (delta[enter_axis] > 0.f) ? -1.f : 1.f;
+	return true;
+}
+
+// A body is fast if it can move further than half its own size in one step, at which point
+// the discrete overlap test can miss thin walls (e.g. 700 px/s projectiles vs 25 px walls).
+bool isFastBody(const Position& position)
+{
+	vec2 delta = position.position - position.prev_position;
+	vec2 half = get_bounding_box(position) / 2.f;
+	return abs(delta.x) > half.x || abs(delta.y) > half.y;
+}
+
+// Below this many candidate pairs the narrow phase is not worth splitting across threads
+const uint MIN_PARALLEL_PAIRS = 256;
+
+// Terrain pieces the sweep candidate buffer starts out with room for, it grows when a sweep needs more
+const uint INITIAL_SWEEP_CANDIDATES = 64;
+
+// Sweeps fast bodies from prev_position to position against the static terrain, moves them back to
+// their time of impact and reports the hit as a contact. Pairs resolved here are stored in
+// swept_pairs so the discrete check does not report them a second time. candidates is scratch space.
+void sweepFastBodies(std::vector<std::pair<uint, uint>>& swept_pairs, std::vector<uint>& candidates)
+{
+	if (candidates.size() < INITIAL_SWEEP_CANDIDATES) candidates.resize(INITIAL_SWEEP_CANDIDATES);
+	swept_pairs.clear();
+	for (uint i = 0; i < registry.velocities.size(); i++) {
+		Entity entity = registry.velocities.entities[i];
+		if (!registry.collidables.has(entity) || registry.terrain.has(entity)) continue;
+		Position& position = registry.positions.get(entity);
+		if (!isFastBody(position)) continue;
+
+		vec2 start = position.prev_position;
+		vec2 delta = position.position - position.prev_position;
+		vec2 half = get_bounding_box(position) / 2.f;
+
+		float earliest_toi = 1.f;
+		vec2 earliest_normal = { 0.f, 0.f };
+		int hit_body = -1;
+
+		// only terrain the body's path passes over can be hit, a full buffer may have dropped some so it
+		// grows and the query runs again
+		vec2 swept_min = min(start, position.position) - half;
+		vec2 swept_max = max(start, position.position) + half;
+		int num_candidates;
+		while ((num_candidates = spatial_grid.query_aabb(swept_min, swept_max, LAYER_TERRAIN, candidates.data(),
+			(int)candidates.size())) == (int)candidates.size())
+			candidates.resize(candidates.size() * 2);
+		for (int j = 0; j < num_candidates; j++) {
+			const SpatialGrid::Body& terrain_body = spatial_grid.body(candidates[j]);
+			Entity terrain_entity = terrain_body.entity;
+			if (registry.terrain.get(terrain_entity).moveable) continue;
+
+			float toi;
+			vec2 normal;
+			vec2 terrain_half = (terrain_body.max - terrain_body.min) / 2.f;
+			if (sweptAABB(start, delta, half, terrain_body.min + terrain_half, terrain_half, toi, normal)
+				&& toi <= earliest_toi) {
+				earliest_toi = toi;
+				earliest_normal = normal;
+				hit_body = candidates[j];
+			}
+		}
+		if (hit_body < 0) continue;
+		Entity hit_terrain = spatial_grid.body(hit_body).entity;
+
+		// stop the body where it touched the wall, backed off slightly so it is not left overlapping
+		float back_off = std::min(earliest_toi, 0.01f / length(delta));
+		position.position = start + delta * (earliest_toi - back_off);
+
+		// already resolved at the time of impact, so there is no displacement left to apply
+		contacts.add(entity, hit_terrain, vec2(0.f, 0.f), earliest_normal);
+		swept_pairs.push_back({ entity, hit_terrain });
+	}
+}
+
+bool wasSwept(const std::vector<std::pair<uint, uint>>& swept_pairs, uint entity_i, uint entity_j)
+{
+	for (const auto& pair : swept_pairs) {
+		if ((pair.first == entity_i && pair.second == entity_j) || (pair.first == entity_j && pair.second == entity_i))
+			return true;
 	}
 	return false;
 }
 
-void updateShadows() {
+// Pairs already covered by the projectile hit pass
+bool isProjectileTargetPair(uint layer_i, uint layer_j)
+{
+	const uint projectiles = LAYER_PLAYER_PROJECTILE | LAYER_ENEMY_PROJECTILE;
+	const uint targets = LAYER_PLAYER | LAYER_ENEMY;
+	return ((layer_i & projectiles) && (layer_j & targets)) || ((layer_i & targets) && (layer_j & projectiles));
+}
+
+// atan2 to within 2e-4 rad, written without branches so a loop of them can be vectorized
+float fastAtan2(float y, float x)
+{
+	float abs_x = abs(x);
+	float abs_y = abs(y);
+	float a = std::min(abs_x, abs_y) / std::max(std::max(abs_x, abs_y), 1e-30f);
+	float s = a * a;
+	float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+	r = (abs_y > abs_x) ? 1.57079637f - r : r;
+	r = (x < 0.f) ? 3.14159274f - r : r;
+	return (y < 0.f) ? -r : r;
+}
+
+void PhysicsSystem::updateShadows() {
 	Entity player_entity = registry.players.entities[0];
 	
 	Position& light_source_pos = (registry.lifeOrbs.entities.size() > 0)
 		? registry.positions.get(registry.lifeOrbs.entities[0])
 		: registry.positions.get(player_entity); //
+	vec2 light = light_source_pos.position;
 
+	// gather the shadows whose owner or light moved since they were last projected
+	shadow_entities.clear();
+	shadow_owner_x.clear();
+	shadow_owner_y.clear();
+	shadow_owner_scale_x.clear();
+	shadow_owner_scale_y.clear();
 	for (uint i = 0; i < registry.shadows.entities.size(); i++) {
 		Entity entity = registry.shadows.entities[i];
-		Shadow& shadow = registry.shadows.get(entity);
+		Shadow& shadow = registry.shadows.components[i];
 
 		Entity owner_entity = shadow.owner;
-
-		Position& shadow_pos = registry.positions.get(entity);
 		if (!registry.positions.has(owner_entity)) {
 			registry.remove_all_components_of(entity);
 			continue;
 		}
 		Position& owner_pos = registry.positions.get(owner_entity);
-		shadow.active = true;
+		if (shadow.projected && owner_pos.position == shadow.owner_position && owner_pos.scale == shadow.owner_scale && light == shadow.light_position)
+			continue;
+		shadow.projected = true;
+		shadow.owner_position = owner_pos.position;
+		shadow.owner_scale = owner_pos.scale;
+		shadow.light_position = light;
 
-		if (distance((shadow_pos.position / vec2(window_width_px, window_height_px)), 
-			(light_source_pos.position / vec2(window_width_px, window_height_px))) > light_radius) {
-			shadow.active = false;
-		}
+		shadow_entities.push_back(entity);
+		shadow_owner_x.push_back(owner_pos.position.x);
+		shadow_owner_y.push_back(owner_pos.position.y);
+		shadow_owner_scale_x.push_back(owner_pos.scale.x);
+		shadow_owner_scale_y.push_back(owner_pos.scale.y);
+	}
 
-		shadow_pos.position = owner_pos.position;
+	uint count = (uint)shadow_entities.size();
+	shadow_angle.resize(count);
+	shadow_x.resize(count);
+	shadow_y.resize(count);
+	shadow_scale_x.resize(count);
+	shadow_scale_y.resize(count);
+
+	// project all of them in one pass over the arrays
+	float max_dist = light_radius * std::max(window_width_px, window_height_px);
+	for (uint k = 0; k < count; k++) {
+		float dx = shadow_owner_x[k] - light.x;
+		float dy = shadow_owner_y[k] - light.y;
+		float dist = sqrt(dx * dx + dy * dy);
+		// cos and sin of the direction away from the light, the same as atan2(0, 0) gives when on top of it
+		float dir_x = (dist > 0.f) ? dx / dist : 1.f;
+		float dir_y = (dist > 0.f) ? dy / dist : 0.f;
 
 		// M_PI / 2 is to make the shadow upright
-		shadow_pos.angle = atan2(owner_pos.position.y - light_source_pos.position.y, owner_pos.position.x - light_source_pos.position.x) + M_PI/2;
+		shadow_angle[k] = fastAtan2(dy, dx) + (float)M_PI / 2;
 
-		float max_dist = light_radius*std::max(window_width_px, window_height_px);
+		float falloff = (max_dist - dist) / max_dist;
+		shadow_scale_x[k] = shadow_owner_scale_x[k] * falloff;
+		shadow_scale_y[k] = shadow_owner_scale_y[k] * falloff * 1.5f;
 
-		float dist = abs(distance(owner_pos.position, light_source_pos.position));
-		shadow_pos.scale = owner_pos.scale * (max_dist - dist) / max_dist;
-		shadow_pos.scale.y *= 1.5;
+		shadow_x[k] = shadow_owner_x[k] + dir_x * (shadow_scale_y[k] / 2);
+		shadow_y[k] = shadow_owner_y[k] + shadow_owner_scale_y[k] / 2 + shadow_scale_y[k] / 2 * dir_y;
+	}
 
-		shadow_pos.position.x += cos(shadow_pos.angle - M_PI / 2) * (shadow_pos.scale.y / 2);
-		shadow_pos.position.y += owner_pos.scale.y / 2 + shadow_pos.scale.y / 2 * sin(shadow_pos.angle - M_PI/2);
+	for (uint k = 0; k < count; k++) {
+		Position& shadow_pos = registry.positions.get(shadow_entities[k]);
+		shadow_pos.position = { shadow_x[k], shadow_y[k] };
+		shadow_pos.angle = shadow_angle[k];
+		shadow_pos.scale = { shadow_scale_x[k], shadow_scale_y[k] };
+		// from the new projection, the shadow is only projected again once something moves
+		registry.shadows.get(shadow_entities[k]).active = distance((vec2(shadow_x[k], shadow_y[k]) / vec2(window_width_px, window_height_px)),
+			(light / vec2(window_width_px, window_height_px))) <= light_radius;
 	}
 }
 
 void PhysicsSystem::step(float elapsed_ms)
 {
-	if (registry.deathTimers.entities.size() > 0) return;
 	auto& velocity_container = registry.velocities;
+
+	// Remember where bodies were at the start of the tick, for collision directions and render interpolation
+	for (uint i = 0; i < velocity_container.size(); i++)
+	{
+		Entity entity = velocity_container.entities[i];
+		if (!registry.positions.has(entity)) continue;
+		Position& position = registry.positions.get(entity);
+		position.prev_position = position.position;
+	}
+
+	if (registry.deathTimers.entities.size() > 0) return;
 	for (uint i = 0; i < velocity_container.size(); i++)
 	{
 		Entity entity = velocity_container.entities[i];
@@ -181,30 +345,78 @@ void PhysicsSystem::step(float elapsed_ms)
 		Velocity& velocity = velocity_container.get(entity);
 		Position& position = registry.positions.get(entity);
 		float step_seconds = elapsed_ms / 1000.f;
-		position.prev_position = position.position;
 		position.position[0] += step_seconds * velocity.velocity[0];
 		position.position[1] += step_seconds * velocity.velocity[1];
 	}
 
+	// projectiles that expired or left the level are gone before the grid sees them
+	projectile_pool.update(elapsed_ms);
+
+	contacts.begin_step();
+	spatial_grid.build();
+
+	// Resolve fast bodies against static terrain at their time of impact before the discrete check
+	sweepFastBodies(swept_pairs, sweep_candidates);
+	// swept bodies were moved back, so their cells have to be refreshed
+	if (swept_pairs.size() > 0) spatial_grid.build();
+
 	// Update shadows
 	updateShadows();
 
-	// Check for collisions between things that are collidable
-	auto& collidables_container = registry.collidables;
-	for (uint i = 0; i < collidables_container.size(); i++) {
-		Entity& entity_i = collidables_container.entities[i];
-		for (uint j = i+1; j < collidables_container.size(); j++) {
-			Entity& entity_j = collidables_container.entities[j];
+	// Projectiles against the player and enemies go through their own batched pass
+	projectile_hit_pass.run(spatial_grid, projectile_hits);
+	for (ProjectileHit& hit : projectile_hits) {
+		Entity projectile = spatial_grid.body(hit.projectile).entity;
+		Entity target = spatial_grid.body(hit.target).entity;
+		contacts.add(projectile, target, vec2(0.f, 0.f));
+	}
+
+	// Check for collisions between things that are collidable, the grid only reports pairs whose bounds overlap
+	spatial_grid.find_pairs(candidate_pairs);
+
+	// snapshot what the narrow phase needs so the worker threads never touch the registry
+	narrow_bodies.resize(spatial_grid.size());
+	for (uint b = 0; b < spatial_grid.size(); b++) {
+		Entity entity = spatial_grid.body(b).entity;
+		NarrowBody& body = narrow_bodies[b];
+		body.id = entity;
+		body.mesh = registry.meshPtrs.get(entity);
+		body.position = registry.positions.get(entity);
+		body.terrain = registry.terrain.has(entity);
+		body.moveable = body.terrain && registry.terrain.get(entity).moveable;
+		body.exit_door = registry.exitDoors.has(entity);
+	}
+
+	// narrow phase on all threads, each one only writing to its own buffer
+	thread_contacts.resize(jobs.thread_count());
+	for (std::vector<NarrowContact>& found : thread_contacts)
+		found.clear();
+	jobs.parallel_for((uint)candidate_pairs.size(), MIN_PARALLEL_PAIRS, [this](uint begin, uint end, uint worker) {
+		std::vector<NarrowContact>& found = thread_contacts[worker];
+		for (uint p = begin; p < end; p++) {
+			const std::pair<uint, uint>& pair = candidate_pairs[p];
+			if (isProjectileTargetPair(spatial_grid.body(pair.first).layer, spatial_grid.body(pair.second).layer)) continue;
+			const NarrowBody& body_i = narrow_bodies[pair.first];
+			const NarrowBody& body_j = narrow_bodies[pair.second];
 			// Ignore terrain-terrain and terrain-exitDoor collision
-			if (shouldIgnoreCollision(entity_i, entity_j)) continue;
-			// Broad phase of collision check
-			if (AABBCollides(entity_i, entity_j)) {
-				// Narrow phase of collision check
-				diagonalCollides(entity_i, entity_j);
-			}
+			if (shouldIgnoreCollision(body_i, body_j)) continue;
+			if (wasSwept(swept_pairs, body_i.id, body_j.id)) continue;
+			vec2 displacement;
+			if (diagonalCollides(body_i, body_j, displacement))
+				found.push_back({ pair.first, pair.second, displacement });
+		}
+	});
 
+	// merged in thread order, and the contact cache sorts by entity pair, so the result is the
+	// same no matter how many threads ran
+	for (uint worker = 0; worker < jobs.thread_count(); worker++) {
+		for (NarrowContact& contact : thread_contacts[worker]) {
+			Entity entity_i = spatial_grid.body(contact.body_i).entity;
+			Entity entity_j = spatial_grid.body(contact.body_j).entity;
+			contacts.add(entity_i, entity_j, contact.displacement);
 		}
 	}
+	contacts.end_step();
 
 	// update position of entities that follow player or enemies to remove jitter
 	for (int i = 0; i < registry.followers.size(); i++) {
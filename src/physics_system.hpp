@@ -4,6 +4,27 @@
 #include "tiny_ecs.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "projectile_hits.hpp"
+
+// What the narrow phase needs of a collidable, copied out of the registry before the
+// pair tests are split across threads
+struct NarrowBody
+{
+	uint id;
+	const Mesh* mesh;
+	Position position;
+	bool terrain;
+	bool moveable;
+	bool exit_door;
+};
+
+// A narrow phase hit between two grid bodies, displacement pulls body_i out of body_j
+struct NarrowContact
+{
+	uint body_i;
+	uint body_j;
+	vec2 displacement;
+};
 
 // A simple physics system that moves rigid bodies and checks for collision
 class PhysicsSystem
@@ -14,4 +35,31 @@ public:
 	PhysicsSystem()
 	{
 	}
+
+private:
+	// Re-project the shadows whose owner or light source moved
+	void updateShadows();
+
+	// reused every step so collision detection does not allocate
+	std::vector<std::pair<uint, uint>> swept_pairs;
+	std::vector<uint> sweep_candidates;
+	std::vector<std::pair<uint, uint>> candidate_pairs;
+
+	std::vector<NarrowBody> narrow_bodies;
+	std::vector<std::vector<NarrowContact>> thread_contacts; // one buffer per job system thread
+
+	// shadows being re-projected this step, packed as structure of arrays
+	std::vector<Entity> shadow_entities;
+	std::vector<float> shadow_owner_x;
+	std::vector<float> shadow_owner_y;
+	std::vector<float> shadow_owner_scale_x;
+	std::vector<float> shadow_owner_scale_y;
+	std::vector<float> shadow_angle;
+	std::vector<float> shadow_x;
+	std::vector<float> shadow_y;
+	std::vector<float> shadow_scale_x;
+	std::vector<float> shadow_scale_y;
+
+	ProjectileHitPass projectile_hit_pass;
+	std::vector<ProjectileHit> projectile_hits;
 };
\ No newline at end of file
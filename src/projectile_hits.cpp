@@ -0,0 +1,96 @@
+// internal
+#include "projectile_hits.hpp"
+
+// stlib
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROJECTILE_HITS_SSE2
+#include <emmintrin.h>
+#endif
+
+const uint PROJECTILE_LAYERS = LAYER_PLAYER_PROJECTILE | LAYER_ENEMY_PROJECTILE;
+
+int circlesVsBox(const float* x, const float* y, const float* r, int count, vec2 box_min, vec2 box_max, uint* hits)
+{
+	int num_hits = 0;
+	int i = 0;
+#ifdef PROJECTILE_HITS_SSE2
+	const __m128 min_x = _mm_set1_ps(box_min.x);
+	const __m128 min_y = _mm_set1_ps(box_min.y);
+	const __m128 max_x = _mm_set1_ps(box_max.x);
+	const __m128 max_y = _mm_set1_ps(box_max.y);
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		__m128 cx = _mm_loadu_ps(x + i);
+		__m128 cy = _mm_loadu_ps(y + i);
+		__m128 cr = _mm_loadu_ps(r + i);
+		// distance from the centre to the box along each axis, 0 when inside the box's span
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_x, cx), _mm_sub_ps(cx, max_x)), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_y, cy), _mm_sub_ps(cy, max_y)), zero);
+		__m128 dist_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(dist_sq, _mm_mul_ps(cr, cr)));
+		while (mask) {
+			int lane = 0;
+			while (!(mask & (1 << lane))) lane++;
+			hits[num_hits++] = i + lane;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	// remaining circles (or all of them without SSE2), written branch free so it can auto-vectorize
+	for (; i < count; i++) {
+		float dx = std::max(std::max(box_min.x - x[i], x[i] - box_max.x), 0.f);
+		float dy = std::max(std::max(box_min.y - y[i], y[i] - box_max.y), 0.f);
+		hits[num_hits] = i;
+		num_hits += (dx * dx + dy * dy <= r[i] * r[i]);
+	}
+	return num_hits;
+}
+
+void ProjectileHitPass::run(const SpatialGrid& grid, std::vector<ProjectileHit>& hits)
+{
+	hits.clear();
+
+	// pack every projectile as a circle that fits inside its sprite
+	float max_radius = 0.f;
+	circle_x.resize(grid.size());
+	circle_y.resize(grid.size());
+	circle_r.resize(grid.size());
+	for (uint b = 0; b < grid.size(); b++) {
+		const SpatialGrid::Body& body = grid.body(b);
+		if (!(body.layer & PROJECTILE_LAYERS)) continue;
+		vec2 half = (body.max - body.min) / 2.f;
+		circle_x[b] = body.min.x + half.x;
+		circle_y[b] = body.min.y + half.y;
+		circle_r[b] = std::min(half.x, half.y);
+		max_radius = std::max(max_radius, circle_r[b]);
+	}
+
+	candidates.resize(grid.size());
+	for (uint t = 0; t < grid.size(); t++) {
+		const SpatialGrid::Body& target = grid.body(t);
+		if (!(target.layer & (LAYER_PLAYER | LAYER_ENEMY))) continue;
+
+		// the player can only be hit by hostile projectiles, enemies by both kinds
+		uint mask = (target.layer & LAYER_PLAYER) ? (uint)LAYER_ENEMY_PROJECTILE : PROJECTILE_LAYERS;
+		int num_candidates = grid.query_aabb(target.min - max_radius, target.max + max_radius, mask,
+			candidates.data(), (int)candidates.size());
+		if (num_candidates == 0) continue;
+
+		candidate_x.resize(num_candidates);
+		candidate_y.resize(num_candidates);
+		candidate_r.resize(num_candidates);
+		candidate_hits.resize(num_candidates);
+		for (int c = 0; c < num_candidates; c++) {
+			candidate_x[c] = circle_x[candidates[c]];
+			candidate_y[c] = circle_y[candidates[c]];
+			candidate_r[c] = circle_r[candidates[c]];
+		}
+
+		int num_hits = circlesVsBox(candidate_x.data(), candidate_y.data(), candidate_r.data(), num_candidates,
+			target.min, target.max, candidate_hits.data());
+		for (int h = 0; h < num_hits; h++)
+			hits.push_back({ candidates[candidate_hits[h]], t });
+	}
+}
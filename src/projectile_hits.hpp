@@ -0,0 +1,42 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "spatial_grid.hpp"
+
+// stlib
+#include <vector>
+
+// A projectile touching a player or enemy, both given as spatial grid body indices
+struct ProjectileHit
+{
+	uint projectile;
+	uint target;
+};
+
+// Dedicated hit test between projectiles and the player/enemies. Projectiles are the most
+// numerous collidables, so rather than going through the generic narrow phase each one is
+// treated as a circle and tested against target boxes in batches.
+class ProjectileHitPass
+{
+public:
+	// Finds every projectile-target hit in the grid, hits is cleared first
+	void run(const SpatialGrid& grid, std::vector<ProjectileHit>& hits);
+
+private:
+	// Projectile circles packed as structure of arrays, indexed by grid body
+	std::vector<float> circle_x;
+	std::vector<float> circle_y;
+	std::vector<float> circle_r;
+
+	// Candidates of the target being tested, gathered contiguously for the kernel
+	std::vector<uint> candidates;
+	std::vector<float> candidate_x;
+	std::vector<float> candidate_y;
+	std::vector<float> candidate_r;
+	std::vector<uint> candidate_hits;
+};
+
+// Tests count circles against one box and writes the indices of those touching it to hits,
+// returns the number of hits. Processes four circles at a time where SSE2 is available.
+int circlesVsBox(const float* x, const float* y, const float* r, int count, vec2 box_min, vec2 box_max, uint* hits);
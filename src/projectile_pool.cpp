@@ -0,0 +1,179 @@
+// internal
+#include "projectile_pool.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <limits>
+#include <algorithm>
+
+ProjectilePool projectile_pool;
+
+// Most projectiles alive at once, the arrays are reserved up front so they never reallocate
+const uint MAX_PROJECTILES = 65536;
+// How far past the outermost terrain a projectile may go before it is culled
+const float CULL_MARGIN = 200.f;
+const uint NO_SLOT = std::numeric_limits<uint>::max();
+// Stale heap entries allowed beyond one per live projectile before the heap is rebuilt
+const uint MAX_STALE_EXPIRIES = 1024;
+
+ProjectilePool::ProjectilePool()
+{
+	slot_entities.reserve(MAX_PROJECTILES);
+	slot_expire_ms.reserve(MAX_PROJECTILES);
+	slot_generation.reserve(MAX_PROJECTILES);
+	slot_live.reserve(MAX_PROJECTILES);
+	free_slots.reserve(MAX_PROJECTILES);
+	cooling_slots.reserve(MAX_PROJECTILES);
+}
+
+Entity ProjectilePool::acquire(float lifetime_ms)
+{
+	uint slot;
+	if (free_slots.size() > 0) {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	else if (slot_entities.size() < MAX_PROJECTILES) {
+		slot = (uint)slot_entities.size();
+		slot_entities.push_back(Entity());
+		slot_expire_ms.push_back(0.f);
+		slot_generation.push_back(0);
+		slot_live.push_back(0);
+	}
+	else {
+		slot = soonestSlot();
+	}
+	slot_expire_ms[slot] = time_ms + lifetime_ms;
+	slot_generation[slot]++;
+	slot_live[slot] = 1;
+	num_live++;
+	pushExpiry(slot);
+
+	Entity entity = slot_entities[slot];
+	registry.projectiles.emplace(entity).pool_slot = slot;
+	return entity;
+}
+
+// The old projectile gets no cooling step, its entity is replaced so the contact cache sees the
+// new one as a different body and ends the old pairs on its own
+uint ProjectilePool::soonestSlot()
+{
+	while (true) {
+		Expiry soonest = expiry_heap.front();
+		std::pop_heap(expiry_heap.begin(), expiry_heap.end(), laterExpiry);
+		expiry_heap.pop_back();
+		if (!isCurrent(soonest)) continue;
+		restart(soonest.slot);
+		return soonest.slot;
+	}
+}
+
+// Orders the expiry heap soonest first
+bool ProjectilePool::laterExpiry(const Expiry& a, const Expiry& b)
+{
+	return a.time_ms > b.time_ms;
+}
+
+bool ProjectilePool::isCurrent(const Expiry& expiry) const
+{
+	return slot_live[expiry.slot] && slot_generation[expiry.slot] == expiry.generation;
+}
+
+void ProjectilePool::pushExpiry(uint slot)
+{
+	expiry_heap.push_back({ slot_expire_ms[slot], slot, slot_generation[slot] });
+	std::push_heap(expiry_heap.begin(), expiry_heap.end(), laterExpiry);
+}
+
+void ProjectilePool::release(Entity projectile)
+{
+	uint slot = sleep(projectile);
+	if (slot != NO_SLOT) cooling_slots.push_back(slot);
+}
+
+uint ProjectilePool::sleep(Entity projectile)
+{
+	if (!registry.projectiles.has(projectile)) return NO_SLOT;
+	uint slot = registry.projectiles.get(projectile).pool_slot;
+	registry.projectiles.remove(projectile);
+	registry.collidables.remove(projectile);
+	registry.renderRequests.remove(projectile);
+	registry.velocities.remove(projectile);
+	registry.animations.remove(projectile);
+
+	slot_live[slot] = 0;
+	num_live--;
+	return slot;
+}
+
+void ProjectilePool::restart(uint slot)
+{
+	registry.remove_all_components_of(slot_entities[slot]);
+	slot_entities[slot] = Entity();
+	slot_live[slot] = 0;
+	num_live--;
+}
+
+void ProjectilePool::update(float elapsed_ms)
+{
+	time_ms += elapsed_ms;
+	free_slots.insert(free_slots.end(), cooling_slots.begin(), cooling_slots.end());
+	cooling_slots.clear();
+
+	for (uint s = 0; s < slot_entities.size(); s++) {
+		if (!slot_live[s]) continue;
+		Entity entity = slot_entities[s];
+		// removed through the registry rather than release, the slot starts over with a new entity
+		if (!registry.projectiles.has(entity)) {
+			restart(s);
+			cooling_slots.push_back(s);
+			continue;
+		}
+
+		bool expired = slot_expire_ms[s] <= time_ms;
+		if (!expired && has_bounds) {
+			vec2 position = registry.positions.get(entity).position;
+			expired = position.x < bounds_min.x || position.y < bounds_min.y || position.x > bounds_max.x || position.y > bounds_max.y;
+		}
+		if (expired) release(entity);
+	}
+
+	// entries of projectiles that went to sleep early are only dropped when they reach the top,
+	// so the heap is rebuilt from the live slots once they pile up
+	while (expiry_heap.size() > 0 && !isCurrent(expiry_heap.front())) {
+		std::pop_heap(expiry_heap.begin(), expiry_heap.end(), laterExpiry);
+		expiry_heap.pop_back();
+	}
+	if (expiry_heap.size() > num_live + MAX_STALE_EXPIRIES) {
+		expiry_heap.clear();
+		for (uint s = 0; s < slot_entities.size(); s++) {
+			if (slot_live[s]) pushExpiry(s);
+		}
+	}
+}
+
+void ProjectilePool::set_bounds(const std::vector<std::pair<vec4, Terrain>>& terrains)
+{
+	has_bounds = terrains.size() > 0;
+	bounds_min = vec2(std::numeric_limits<float>::max());
+	bounds_max = vec2(-std::numeric_limits<float>::max());
+	for (const std::pair<vec4, Terrain>& terrain : terrains) {
+		bounds_min = min(bounds_min, vec2(terrain.first.x, terrain.first.y));
+		bounds_max = max(bounds_max, vec2(terrain.first.x + terrain.first.z, terrain.first.y + terrain.first.w));
+	}
+	bounds_min -= CULL_MARGIN;
+	bounds_max += CULL_MARGIN;
+}
+
+void ProjectilePool::clear()
+{
+	slot_entities.clear();
+	slot_expire_ms.clear();
+	slot_generation.clear();
+	slot_live.clear();
+	expiry_heap.clear();
+	free_slots.clear();
+	cooling_slots.clear();
+	num_live = 0;
+	time_ms = 0.f;
+}
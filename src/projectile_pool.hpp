@@ -0,0 +1,86 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "components.hpp"
+
+// stlib
+#include <vector>
+#include <utility>
+
+// Longest a projectile flies before it is removed, far longer than any boss pattern holds one
+const float PROJECTILE_LIFETIME_MS = 20000.f;
+
+// Recycles projectile entities instead of creating and destroying one per shot. A projectile
+// that hits something, outlives its lifetime or leaves the level is put to sleep: it loses its
+// Projectile, Collidable, RenderRequest, Velocity and Animation components so no system visits it
+// anymore, but keeps its Position, mesh and sprite sheet for the next projectile fired. Expiry
+// times are kept here as structure of arrays by slot, plus a min heap to find the soonest one.
+class ProjectilePool
+{
+public:
+	ProjectilePool();
+
+	// Entity for a new projectile, a sleeping one when there is one. If registry.positions has
+	// it, its Position, mesh and sprite sheet are left over and have to be overwritten rather than
+	// emplaced. When every slot is live the one closest to expiring is removed and its slot reused.
+	Entity acquire(float lifetime_ms);
+
+	// Puts a projectile to sleep, use in place of remove_all_components_of
+	void release(Entity projectile);
+
+	// Ages every live projectile and releases the expired ones and those outside the level,
+	// called by the physics system before it builds the grid
+	void update(float elapsed_ms);
+
+	// Level area projectiles may live in, from the terrain given as top left corner and size
+	void set_bounds(const std::vector<std::pair<vec4, Terrain>>& terrains);
+
+	// Forget every slot, for when the registry has been cleared
+	void clear();
+
+	// Bumped every time the slot is acquired, tells a projectile apart from an earlier one
+	// that used the same entity
+	uint generation(uint slot) const { return slot_generation[slot]; }
+
+	uint live_count() const { return num_live; }
+	uint slot_count() const { return (uint)slot_entities.size(); }
+
+private:
+	// A live slot and the time it expires at, stale once the slot has been acquired again
+	struct Expiry
+	{
+		float time_ms;
+		uint slot;
+		uint generation;
+	};
+
+	// Puts the projectile to sleep and returns its slot, NO_SLOT if it is not a live projectile
+	uint sleep(Entity projectile);
+	// Removes the slot's entity altogether and gives the slot a fresh one
+	void restart(uint slot);
+	// Every slot is live, frees the one that expires first
+	uint soonestSlot();
+	static bool laterExpiry(const Expiry& a, const Expiry& b);
+	bool isCurrent(const Expiry& expiry) const;
+	void pushExpiry(uint slot);
+
+	std::vector<Entity> slot_entities;
+	std::vector<float> slot_expire_ms; // on the pool's clock
+	std::vector<uint> slot_generation; // bumped on every acquire
+	std::vector<unsigned char> slot_live;
+	std::vector<Expiry> expiry_heap; // soonest first, may hold stale entries of reused slots
+	std::vector<uint> free_slots; // slots whose entity sleeps
+	// slots released since the last update, held back one physics step so the contact cache
+	// ends their old pairs before the entity can touch anything again
+	std::vector<uint> cooling_slots;
+	uint num_live = 0;
+	float time_ms = 0.f; // time the pool has been updated for
+
+	bool has_bounds = false;
+	vec2 bounds_min = { 0.f, 0.f };
+	vec2 bounds_max = { 0.f, 0.f };
+};
+
+extern ProjectilePool projectile_pool;
@@ -0,0 +1,110 @@
+// internal
+#include "projectile_volleys.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "projectile_pool.hpp"
+
+ProjectileVolleys volleys;
+
+// Finds the entity's component at its cached index, looking it up only when the container moved it
+template <typename Component>
+bool componentIndex(ComponentContainer<Component>& container, Entity entity, uint& index)
+{
+	if (index < container.entities.size() && container.entities[index] == entity) return true;
+	if (!container.has(entity)) return false;
+	index = (uint)(&container.get(entity) - container.components.data());
+	return true;
+}
+
+uint ProjectileVolleys::create()
+{
+	volleys.emplace_back();
+	return (uint)volleys.size() - 1;
+}
+
+void ProjectileVolleys::add(uint volley, Entity projectile)
+{
+	Projectile& component = registry.projectiles.get(projectile);
+	component.volley = volley;
+	Volley& group = volleys[volley];
+	group.entities.push_back(projectile);
+	group.generation.push_back(projectile_pool.generation(component.pool_slot));
+	group.projectile_index.push_back(~0u);
+	group.position_index.push_back(~0u);
+	group.velocity_index.push_back(~0u);
+}
+
+ProjectileVolleys::Volley& ProjectileVolleys::members(uint volley)
+{
+	Volley& group = volleys[volley];
+	uint alive = 0;
+	for (uint i = 0; i < group.entities.size(); i++) {
+		Entity entity = group.entities[i];
+		uint projectile = group.projectile_index[i];
+		uint position = group.position_index[i];
+		uint velocity = group.velocity_index[i];
+		if (!componentIndex(registry.projectiles, entity, projectile)) continue;
+		// a pooled entity may have been fired again since, in this volley or another one
+		const Projectile& component = registry.projectiles.components[projectile];
+		if (component.volley != volley || projectile_pool.generation(component.pool_slot) != group.generation[i]) continue;
+		if (!componentIndex(registry.positions, entity, position) || !componentIndex(registry.velocities, entity, velocity)) continue;
+
+		group.entities[alive] = entity;
+		group.generation[alive] = group.generation[i];
+		group.projectile_index[alive] = projectile;
+		group.position_index[alive] = position;
+		group.velocity_index[alive] = velocity;
+		alive++;
+	}
+	group.entities.erase(group.entities.begin() + alive, group.entities.end());
+	group.generation.resize(alive);
+	group.projectile_index.resize(alive);
+	group.position_index.resize(alive);
+	group.velocity_index.resize(alive);
+	return group;
+}
+
+void ProjectileVolleys::set_velocity(uint volley, vec2 velocity)
+{
+	Volley& group = members(volley);
+	Velocity* velocities = registry.velocities.components.data();
+	for (uint index : group.velocity_index)
+		velocities[index].velocity = velocity;
+}
+
+void ProjectileVolleys::steer_toward(uint volley, vec2 point, float speed)
+{
+	Volley& group = members(volley);
+	Position* positions = registry.positions.components.data();
+	Velocity* velocities = registry.velocities.components.data();
+	for (uint i = 0; i < group.entities.size(); i++) {
+		vec2 to_point = point - positions[group.position_index[i]].position;
+		float dist = length(to_point);
+		if (dist > 0.f) velocities[group.velocity_index[i]].velocity = to_point * (speed / dist);
+	}
+}
+
+void ProjectileVolleys::scale_speed(uint volley, float factor)
+{
+	Volley& group = members(volley);
+	Velocity* velocities = registry.velocities.components.data();
+	for (uint index : group.velocity_index)
+		velocities[index].velocity *= factor;
+}
+
+void ProjectileVolleys::despawn(uint volley)
+{
+	Volley& group = members(volley);
+	for (Entity projectile : group.entities)
+		projectile_pool.release(projectile);
+	group = Volley();
+}
+
+uint ProjectileVolleys::size(uint volley)
+{
+	return (uint)members(volley).entities.size();
+}
+
+void ProjectileVolleys::clear()
+{
+	volleys.assign(1, Volley());
+}
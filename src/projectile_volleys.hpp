@@ -0,0 +1,49 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+// stlib
+#include <vector>
+
+// Groups of projectiles fired together that can be moved or removed as one. Each group keeps
+// its members as structure of arrays together with the dense indices of their components in
+// the registry, so an operation is a loop over the group indexing straight into the component
+// arrays. An index is only looked up again when the registry moved that component, and
+// projectiles that were destroyed or put to sleep some other way are dropped the next time the
+// group is used, even when the pool has fired their entity again since.
+class ProjectileVolleys
+{
+public:
+	// A new empty group, ids start at 1 so 0 can mean no group
+	uint create();
+	// Put a projectile in a group and tag it with the group's id
+	void add(uint volley, Entity projectile);
+
+	void set_velocity(uint volley, vec2 velocity);
+	// Every projectile heads straight for point, or straight away from it for a negative speed
+	void steer_toward(uint volley, vec2 point, float speed);
+	void scale_speed(uint volley, float factor);
+	void despawn(uint volley);
+
+	uint size(uint volley);
+	void clear();
+
+private:
+	struct Volley
+	{
+		std::vector<Entity> entities;
+		std::vector<uint> generation; // pool slot generation the member was added with
+		std::vector<uint> projectile_index; // into registry.projectiles
+		std::vector<uint> position_index; // into registry.positions
+		std::vector<uint> velocity_index; // into registry.velocities
+	};
+
+	// Drops members that no longer exist and brings the indices of the rest up to date
+	Volley& members(uint volley);
+
+	std::vector<Volley> volleys = { Volley() }; // indexed by id, 0 is never used
+};
+
+extern ProjectileVolleys volleys;
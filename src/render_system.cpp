@@ -1,19 +1,55 @@
 // internal
 #include "render_system.hpp"
 #include <SDL.h>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 
 #include "tiny_ecs_registry.hpp"
 
-void RenderSystem::drawTexturedMesh(Entity entity,
-	const mat3& projection)
+// Layout of a RenderItem key
+const int RENDER_KEY_PASS_SHIFT = 60;
+const int RENDER_KEY_LAYER_SHIFT = 52;
+const int RENDER_KEY_DEPTH_SHIFT = 28;
+const int RENDER_KEY_EFFECT_SHIFT = 20;
+const uint64_t RENDER_KEY_DEPTH_MASK = (1 << 24) - 1;
+const uint64_t RENDER_KEY_TEXTURE_MASK = (1 << 20) - 1;
+// Depth is the y coordinate in pixels, biased so the world can reach into negative coordinates
+const int RENDER_KEY_DEPTH_BIAS = 1 << 23;
+// Sprites whose keys agree on these bits can be drawn with one call
+const uint64_t RENDER_KEY_BATCH_MASK = ((uint64_t)0xFF << RENDER_KEY_EFFECT_SHIFT) | RENDER_KEY_TEXTURE_MASK;
+
+// Position an entity is drawn at, blended between its last two simulation ticks
+vec2 RenderSystem::interpolatedPosition(Entity entity)
+{
+	// followers and shadows are placed relative to their owner, so they follow its interpolated position
+	if (registry.followers.has(entity)) {
+		Follower& follower = registry.followers.get(entity);
+		return interpolatedPosition(follower.owner) + vec2(follower.x_offset, follower.y_offset);
+	}
+	if (registry.secondaryFollowers.has(entity)) {
+		SecondaryFollower& follower = registry.secondaryFollowers.get(entity);
+		return interpolatedPosition(follower.owner) + vec2(follower.x_offset, follower.y_offset);
+	}
+	Position& position = registry.positions.get(entity);
+	if (registry.shadows.has(entity)) {
+		Entity owner = registry.shadows.get(entity).owner;
+		if (registry.positions.has(owner))
+			return position.position + interpolatedPosition(owner) - registry.positions.get(owner).position;
+	}
+	// only moving bodies have a meaningful prev_position
+	if (!registry.velocities.has(entity)) return position.position;
+	return mix(position.prev_position, position.position, interpolation_alpha);
+}
+
+void RenderSystem::drawTexturedMesh(Entity entity)
 {
 	Position& position = registry.positions.get(entity);
 	// Transformation code, see Rendering and Transformation in the template
 	// specification for more info Incrementally updates transformation matrix,
 	// thus ORDER IS IMPORTANT
 	Transform transform;
-	transform.translate(position.position);
+	transform.translate(interpolatedPosition(entity));
 	transform.rotate(position.angle);
 	transform.scale(position.scale);
 
@@ -23,18 +59,15 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
 	const GLuint program = (GLuint)effects[used_effect_enum];
+	const EffectLocations& locations = effect_locations[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
+	gl_state.useProgram(program);
 	gl_has_errors();
 
+	// The geometry's vertex array has its buffers and attribute layout baked in
 	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	gl_state.bindVertexArray(vertex_arrays[(GLuint)render_request.used_geometry]);
 	gl_has_errors();
 
 	// Input data location as in the vertex buffer
@@ -43,31 +76,14 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		render_request.used_effect == EFFECT_ASSET_ID::ANIMATED ||
 		render_request.used_effect == EFFECT_ASSET_ID::REPEAT)
 	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-			sizeof(TexturedVertex), (void*)0);
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void*)sizeof(
-				vec3)); // note the stride to skip the preceeding vertex position
-
 		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
 		assert(registry.renderRequests.has(entity));
 		GLuint texture_id =
 			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
 
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		gl_state.bindTexture(0, texture_id);
+		const vec4& atlas_rect = texture_uv_rects[(GLuint)render_request.used_texture];
+		glUniform4fv(locations.atlas_rect, 1, (float*)&atlas_rect);
 		gl_has_errors();
 
 		if (render_request.used_effect == EFFECT_ASSET_ID::RESOURCE_BAR) {
@@ -94,21 +110,20 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 				logoRatio = resources.logoRatio;
 				barRatio = resources.barRatio;
 			}
-			glUniform1f(glGetUniformLocation(program, "fraction"), fraction);
-			glUniform1f(glGetUniformLocation(program, "logoRatio"), logoRatio);
-			glUniform1f(glGetUniformLocation(program, "barRatio"), barRatio);
+			glUniform1f(locations.fraction, fraction);
+			glUniform1f(locations.logo_ratio, logoRatio);
+			glUniform1f(locations.bar_ratio, barRatio);
 			gl_has_errors();
 		}
 		else if (render_request.used_effect == EFFECT_ASSET_ID::ANIMATED) {
 			assert(registry.animations.has(entity));
 			Animation& animation = registry.animations.get(entity);
 			assert(animation.sprite_sheet_ptr != nullptr);
-			glUniform1f(glGetUniformLocation(program, "time"), (float)(glfwGetTime() * 10.0f));
-			glUniform1i(glGetUniformLocation(program, "frame_col"), animation.getColumn());
-			glUniform1i(glGetUniformLocation(program, "frame_row"), animation.getRow());
-			glUniform1f(glGetUniformLocation(program, "frame_width"), animation.sprite_sheet_ptr->getFrameSizeInTexcoords().x);
-			glUniform1f(glGetUniformLocation(program, "frame_height"), animation.sprite_sheet_ptr->getFrameSizeInTexcoords().y);
-			glUniform1i(glGetUniformLocation(program, "rainbow_enabled"), animation.rainbow_enabled);
+			glUniform1i(locations.frame_col, animation.getColumn());
+			glUniform1i(locations.frame_row, animation.getRow());
+			glUniform1f(locations.frame_width, animation.sprite_sheet_ptr->getFrameSizeInTexcoords().x);
+			glUniform1f(locations.frame_height, animation.sprite_sheet_ptr->getFrameSizeInTexcoords().y);
+			glUniform1i(locations.rainbow_enabled, animation.rainbow_enabled);
 			gl_has_errors();
 		}
 		else if (render_request.used_effect == EFFECT_ASSET_ID::REPEAT) {
@@ -134,27 +149,13 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 				x_scale = position.scale.x / 100;
 				y_scale = position.scale.y / 100;
 			}
-			glUniform1f(glGetUniformLocation(program, "x_scale"), x_scale);
-			glUniform1f(glGetUniformLocation(program, "y_scale"), y_scale);
+			glUniform1f(locations.x_scale, x_scale);
+			glUniform1f(locations.y_scale, y_scale);
 		}
 	}
 	// This is kind of useless now
 	else if (render_request.used_effect == EFFECT_ASSET_ID::PLAYER || render_request.used_effect == EFFECT_ASSET_ID::EXIT_DOOR)
 	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_color_loc = glGetAttribLocation(program, "in_color");
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-			sizeof(ColoredVertex), (void*)0);
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_color_loc);
-		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
-			sizeof(ColoredVertex), (void*)sizeof(vec3));
-		gl_has_errors();
-
 		if (render_request.used_effect == EFFECT_ASSET_ID::PLAYER) {
 
 			float time = (float) glfwGetTime();
@@ -162,38 +163,21 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 			vec3 final_color = vec3(0.8f, 0.0f, 0.0f);
 			vec3 color_change = initial_color + (final_color - initial_color) * sin(time);
 
-			GLuint change_uloc = glGetUniformLocation(program, "change");
+			GLuint change_uloc = locations.change;
 			glUniform3f(change_uloc, color_change.x, color_change.y, color_change.z);
 			gl_has_errors();
 		}
 	}
 	else if (render_request.used_effect == EFFECT_ASSET_ID::SHADOW) {
 		if (!registry.shadows.get(entity).active) return;
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-			sizeof(TexturedVertex), (void*)0);
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void*)sizeof(
-				vec3)); // note the stride to skip the preceeding vertex position
-
 		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
 		assert(registry.renderRequests.has(entity));
 		GLuint texture_id =
 			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
 
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		gl_state.bindTexture(0, texture_id);
+		const vec4& atlas_rect = texture_uv_rects[(GLuint)render_request.used_texture];
+		glUniform4fv(locations.atlas_rect, 1, (float*)&atlas_rect);
 		gl_has_errors();
 	}
 	else
@@ -202,30 +186,20 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	}
 
 	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
+	GLint color_uloc = locations.fcolor;
 	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
 	glUniform3fv(color_uloc, 1, (float*)&color);
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
+	GLsizei num_indices = index_counts[(GLuint)render_request.used_geometry];
 
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+	// the projection comes from the frame uniform buffer
+	glUniformMatrix3fv(locations.transform, 1, GL_FALSE, (float*)&transform.mat);
 	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
 	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
+	perf_stats.draw_calls++;
 }
 
 // draw the intermediate texture to the screen
@@ -233,59 +207,44 @@ void RenderSystem::drawToScreen()
 {
 	// Setting shaders
 	// get the lighting texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::DARKEN]);
+	gl_state.useProgram(effects[(GLuint)EFFECT_ASSET_ID::DARKEN]);
 	gl_has_errors();
 	// Clearing backbuffer
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, w, h);
+	gl_state.viewport(0, 0, w, h);
 	glDepthRange(0, 10);
 	glClearColor(1.f, 0, 0, 1.0);
 	glClearDepth(1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	gl_has_errors();
 	// Enabling alpha channel for textures
-	glDisable(GL_BLEND);
+	gl_state.setBlend(false);
 	//glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDisable(GL_DEPTH_TEST);
 
 	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
+	gl_state.bindVertexArray(vertex_arrays[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
 	gl_has_errors();
-	const GLuint darken_program = effects[(GLuint)EFFECT_ASSET_ID::DARKEN];
+	const EffectLocations& locations = effect_locations[(GLuint)EFFECT_ASSET_ID::DARKEN];
 
 	// Pass light radius to the post-processing shader
-	glUniform1f(glGetUniformLocation(darken_program, "light_radius"), light_radius);
+	glUniform1f(locations.light_radius, light_radius);
 
 	// Set clock
-	GLuint window_size_uloc = glGetUniformLocation(darken_program, "window_size");
-	GLuint dead_timer_uloc = glGetUniformLocation(darken_program, "screen_darken_factor");
-	GLuint radius_uloc = glGetUniformLocation(darken_program, "radius");
-	GLuint apply_spotlight_bool = glGetUniformLocation(darken_program, "apply_spotlight");
+	GLuint dead_timer_uloc = locations.screen_darken_factor;
+	GLuint radius_uloc = locations.radius;
+	GLuint apply_spotlight_bool = locations.apply_spotlight;
 	
 	ScreenState& screen = registry.screenStates.get(screen_state_entity);
 
-	glUniform2f(window_size_uloc, window_width_px, window_height_px);
 	glUniform1f(radius_uloc, screen.spotlight_radius);
 	glUniform1f(apply_spotlight_bool, screen.apply_spotlight);
 	glUniform1f(dead_timer_uloc, screen.screen_darken_factor);
 	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(darken_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
 	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	gl_state.bindTexture(0, off_screen_render_buffer_color);
 	gl_has_errors();
 	// Draw
 	glDrawElements(
@@ -293,12 +252,13 @@ void RenderSystem::drawToScreen()
 		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
 	// no offset from the bound index buffer
 	gl_has_errors();
+	perf_stats.draw_calls++;
 }
 
-void RenderSystem::drawArsenal(Entity entity, const mat3& projection){
+void RenderSystem::drawArsenal(Entity entity){
 	Position& position = registry.positions.get(entity);
 	Transform transform;
-	transform.translate(position.position);
+	transform.translate(interpolatedPosition(entity));
 	transform.rotate(position.angle);
 	transform.scale(position.scale);
 
@@ -306,83 +266,294 @@ void RenderSystem::drawArsenal(Entity entity, const mat3& projection){
 	const RenderRequest& render_request = registry.renderRequests.get(entity);
 
 	const GLuint program = (GLuint)effects[(GLuint)EFFECT_ASSET_ID::ANIMATED];
+	const EffectLocations& locations = effect_locations[(GLuint)EFFECT_ASSET_ID::ANIMATED];
 
 	// Setting shaders
-	glUseProgram(program);
+	gl_state.useProgram(program);
 	gl_has_errors();
 
+	// The geometry's vertex array has its buffers and attribute layout baked in
 	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-	gl_has_errors();
-	assert(in_texcoord_loc >= 0);
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-		sizeof(TexturedVertex), (void*)0);
+	gl_state.bindVertexArray(vertex_arrays[(GLuint)render_request.used_geometry]);
 	gl_has_errors();
 
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(
-		in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-		(void*)sizeof(
-			vec3)); // note the stride to skip the preceeding vertex position
-
 	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
-	gl_has_errors();
-
 	assert(registry.renderRequests.has(entity));
 	GLuint texture_id =
 		texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
 
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	gl_state.bindTexture(0, texture_id);
+	const vec4& atlas_rect = texture_uv_rects[(GLuint)render_request.used_texture];
+	glUniform4fv(locations.atlas_rect, 1, (float*)&atlas_rect);
 	gl_has_errors();
 
 	assert(registry.animations.has(entity));
 	Animation& animation = registry.animations.get(entity);
 	assert(animation.sprite_sheet_ptr != nullptr);
-	glUniform1f(glGetUniformLocation(program, "time"), (float)(glfwGetTime() * 10.0f));
-	glUniform1i(glGetUniformLocation(program, "frame_col"), animation.getColumn());
-	glUniform1i(glGetUniformLocation(program, "frame_row"), animation.getRow());
-	glUniform1f(glGetUniformLocation(program, "frame_width"), animation.sprite_sheet_ptr->getFrameSizeInTexcoords().x);
-	glUniform1f(glGetUniformLocation(program, "frame_height"), animation.sprite_sheet_ptr->getFrameSizeInTexcoords().y);
-	glUniform1i(glGetUniformLocation(program, "rainbow_enabled"), animation.rainbow_enabled);
+	glUniform1i(locations.frame_col, animation.getColumn());
+	glUniform1i(locations.frame_row, animation.getRow());
+	glUniform1f(locations.frame_width, animation.sprite_sheet_ptr->getFrameSizeInTexcoords().x);
+	glUniform1f(locations.frame_height, animation.sprite_sheet_ptr->getFrameSizeInTexcoords().y);
+	glUniform1i(locations.rainbow_enabled, animation.rainbow_enabled);
 	gl_has_errors();
 
 	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
+	GLint color_uloc = locations.fcolor;
 	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
 	glUniform3fv(color_uloc, 1, (float*)&color);
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
+	GLsizei num_indices = index_counts[(GLuint)render_request.used_geometry];
 
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+	// the projection comes from the frame uniform buffer
+	glUniformMatrix3fv(locations.transform, 1, GL_FALSE, (float*)&transform.mat);
 	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
 	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
+	perf_stats.draw_calls++;
+}
+
+vec4 RenderSystem::atlasUVRect(TEXTURE_ASSET_ID texture, vec4 uv_rect)
+{
+	const vec4& atlas_rect = texture_uv_rects[(GLuint)texture];
+	return vec4(atlas_rect.x + uv_rect.x * atlas_rect.z, atlas_rect.y + uv_rect.y * atlas_rect.w,
+		uv_rect.z * atlas_rect.z, uv_rect.w * atlas_rect.w);
+}
+
+bool RenderSystem::isBatchedSprite(const RenderRequest& render_request)
+{
+	if (render_request.used_effect != EFFECT_ASSET_ID::TEXTURED && render_request.used_effect != EFFECT_ASSET_ID::ANIMATED)
+		return false;
+	return sprite_uv_rects[(GLuint)render_request.used_geometry].z != 0.f;
+}
+
+SpriteInstance RenderSystem::spriteInstance(Entity entity)
+{
+	const RenderRequest& render_request = registry.renderRequests.get(entity);
+	vec4 uv_rect = sprite_uv_rects[(GLuint)render_request.used_geometry];
+
+	Position& position = registry.positions.get(entity);
+	Transform transform;
+	transform.translate(interpolatedPosition(entity));
+	transform.rotate(position.angle);
+	transform.scale(position.scale);
+
+	SpriteInstance instance = { transform.mat, uv_rect, vec3(1.f), 0.f };
+	if (render_request.used_effect == EFFECT_ASSET_ID::ANIMATED) {
+		// the animated shader shifts by whole frames and ignores the entity's colour
+		assert(registry.animations.has(entity));
+		Animation& animation = registry.animations.get(entity);
+		assert(animation.sprite_sheet_ptr != nullptr);
+		vec2 frame_size = animation.sprite_sheet_ptr->getFrameSizeInTexcoords();
+		instance.uv_rect.x += frame_size.x * animation.getColumn();
+		instance.uv_rect.y += frame_size.y * animation.getRow();
+		instance.rainbow = animation.rainbow_enabled ? 1.f : 0.f;
+	}
+	else if (registry.colors.has(entity)) {
+		instance.color = registry.colors.get(entity);
+	}
+	instance.uv_rect = atlasUVRect(render_request.used_texture, instance.uv_rect);
+	return instance;
+}
+
+// Draws count sprites starting at first in sprite_instances with one instanced call
+void RenderSystem::drawSprites(uint first, uint count, GLuint texture)
+{
+	gl_state.useProgram(effects[(GLuint)EFFECT_ASSET_ID::SPRITE_BATCH]);
+	gl_state.bindVertexArray(sprite_batch_vao);
+	gl_state.bindBuffer(GL_ARRAY_BUFFER, sprite_instance_vbo);
+
+	// GL 3.3 has no base instance, so the instance attributes are pointed at the batch's first sprite
+	const GLsizei stride = sizeof(SpriteInstance);
+	const size_t base = first * sizeof(SpriteInstance);
+	for (GLuint column = 0; column < 3; column++)
+		glVertexAttribPointer(2 + column, 3, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(SpriteInstance, transform) + column * sizeof(vec3)));
+	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, uv_rect)));
+	glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, color)));
+	glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, rainbow)));
+
+	gl_state.bindTexture(0, texture);
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, count);
+	gl_has_errors();
+	perf_stats.draw_calls++;
+	perf_stats.sprite_batches++;
+}
+
+uint RenderSystem::textureSlot(TEXTURE_ASSET_ID texture)
+{
+	if (texture == TEXTURE_ASSET_ID::TEXTURE_COUNT)
+		return (uint)RENDER_KEY_TEXTURE_MASK;
+	int page = texture_atlas_pages[(GLuint)texture];
+	return page >= 0 ? (uint)page : (uint)atlas_page_handles.size() + (uint)texture;
+}
+
+GLuint RenderSystem::slotTexture(uint slot)
+{
+	if (slot < atlas_page_handles.size())
+		return atlas_page_handles[slot];
+	return texture_gl_handles[slot - atlas_page_handles.size()];
+}
+
+bool RenderSystem::renderPass(Entity entity, RENDER_PASS& pass)
+{
+	if (registry.texts.has(entity) || registry.projectileSelectDisplays.has(entity) || registry.powerUpIndicators.has(entity))
+		return false;
+	if (registry.floors.has(entity)) pass = RENDER_PASS::FLOOR;
+	else if (registry.shadows.has(entity)) pass = RENDER_PASS::SHADOW;
+	else if (registry.healthBars.has(entity) || registry.manaBars.has(entity)) pass = RENDER_PASS::HUD;
+	else if (registry.terrain.has(entity)) pass = RENDER_PASS::TERRAIN;
+	else pass = RENDER_PASS::WORLD;
+	return true;
+}
+
+bool RenderSystem::inFrame(Entity entity, RENDER_PASS pass)
+{
+	if (pass == RENDER_PASS::HUD && registry.cutscenes.size() > 0) return false;
+	if (pass == RENDER_PASS::SHADOW && !registry.shadows.get(entity).active) return false;
+	// the HUD is drawn after the lighting, so it only has to be on screen
+	return isVisible(entity, pass != RENDER_PASS::HUD);
+}
+
+uint64_t RenderSystem::renderKey(Entity entity, RENDER_PASS pass)
+{
+	const RenderRequest& render_request = registry.renderRequests.get(entity);
+	// every sprite goes through the same program, so sprites on one texture batch across depths
+	EFFECT_ASSET_ID effect = isBatchedSprite(render_request) ? EFFECT_ASSET_ID::SPRITE_BATCH : render_request.used_effect;
+
+	uint64_t depth = 0;
+	if (pass == RENDER_PASS::WORLD) {
+		// by where the entity meets the ground, so whatever stands lower on screen is drawn over
+		Position& position = registry.positions.get(entity);
+		int feet = (int)floor(interpolatedPosition(entity).y + abs(position.scale.y) / 2.f);
+		depth = (uint64_t)std::min(std::max(feet + RENDER_KEY_DEPTH_BIAS, 0), (int)RENDER_KEY_DEPTH_MASK);
+	}
+
+	return ((uint64_t)pass << RENDER_KEY_PASS_SHIFT) |
+		((uint64_t)(uint8_t)(render_request.layer + 0x80) << RENDER_KEY_LAYER_SHIFT) |
+		(depth << RENDER_KEY_DEPTH_SHIFT) |
+		((uint64_t)effect << RENDER_KEY_EFFECT_SHIFT) |
+		textureSlot(render_request.used_texture);
+}
+
+void RenderSystem::buildRenderQueue()
+{
+	render_frame++;
+
+	// last frame's entities first and in last frame's order, their keys rarely change much
+	size_t num_kept = 0;
+	for (size_t i = 0; i < render_queue.size(); i++) {
+		Entity entity = render_queue[i].entity;
+		if (!registry.renderRequests.has(entity) || !registry.positions.has(entity)) continue;
+		RenderRequest& render_request = registry.renderRequests.get(entity);
+		if (render_request.queued_frame == render_frame) continue;
+		render_request.queued_frame = render_frame;
+		// an entity keeps its pass for as long as it is queued
+		RENDER_PASS pass = (RENDER_PASS)(render_queue[i].key >> RENDER_KEY_PASS_SHIFT);
+		if (inFrame(entity, pass))
+			render_queue[num_kept++] = { renderKey(entity, pass), entity };
+	}
+	render_queue.erase(render_queue.begin() + num_kept, render_queue.end());
+
+	// then everything that was not drawn last frame
+	for (uint i = 0; i < registry.renderRequests.size(); i++) {
+		RenderRequest& render_request = registry.renderRequests.components[i];
+		if (render_request.queued_frame == render_frame) continue;
+		render_request.queued_frame = render_frame;
+		Entity entity = registry.renderRequests.entities[i];
+		RENDER_PASS pass;
+		if (registry.positions.has(entity) && renderPass(entity, pass) && inFrame(entity, pass))
+			render_queue.push_back({ renderKey(entity, pass), entity });
+	}
+
+	sortRenderQueue(num_kept);
+}
+
+void RenderSystem::sortRenderQueue(size_t num_kept)
+{
+	auto by_key = [](const RenderItem& a, const RenderItem& b) { return a.key < b.key; };
+
+	// what was kept is nearly sorted from last frame, insertion sort only moves what moved
+	for (size_t i = 1; i < num_kept; i++) {
+		RenderItem item = render_queue[i];
+		size_t j = i;
+		for (; j > 0 && render_queue[j - 1].key > item.key; j--)
+			render_queue[j] = render_queue[j - 1];
+		render_queue[j] = item;
+	}
+
+	// new entries can belong anywhere, a whole level of them on its first frame, so they are sorted on their own and merged in
+	std::stable_sort(render_queue.begin() + num_kept, render_queue.end(), by_key);
+	std::inplace_merge(render_queue.begin(), render_queue.begin() + num_kept, render_queue.end(), by_key);
+}
+
+void RenderSystem::drawRenderQueue()
+{
+	// instances of every queued sprite in queue order, so each run of sprites is a range of them
+	sprite_instances.clear();
+	for (const RenderItem& item : render_queue)
+		if (((item.key >> RENDER_KEY_EFFECT_SHIFT) & 0xFF) == (uint64_t)EFFECT_ASSET_ID::SPRITE_BATCH)
+			sprite_instances.push_back(spriteInstance(item.entity));
+	perf_stats.batched_sprites = (uint)sprite_instances.size();
+	perf_stats.sprite_batches = 0;
+
+	if (sprite_instances.size() > 0) {
+		// orphan last frame's instances rather than waiting for the draws still reading them
+		gl_state.bindBuffer(GL_ARRAY_BUFFER, sprite_instance_vbo);
+		GLsizeiptr buffer_size = sizeof(SpriteInstance) * sprite_instances.size();
+		glBufferData(GL_ARRAY_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, buffer_size, sprite_instances.data());
+		gl_has_errors();
+	}
+
+	// the lighting is applied to everything before the HUD
+	bool post_processed = false;
+	auto post_process = [&]() {
+		drawToScreen();
+		gl_state.setBlend(true);
+		gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		post_processed = true;
+	};
+
+	uint sprite_index = 0;
+	size_t i = 0;
+	while (i < render_queue.size()) {
+		uint64_t key = render_queue[i].key;
+		if (!post_processed && (key >> RENDER_KEY_PASS_SHIFT) >= (uint64_t)RENDER_PASS::HUD)
+			post_process();
+
+		if (((key >> RENDER_KEY_EFFECT_SHIFT) & 0xFF) == (uint64_t)EFFECT_ASSET_ID::SPRITE_BATCH) {
+			// consecutive sprites on one texture are drawn together, whatever their layer or depth
+			size_t last = i + 1;
+			while (last < render_queue.size() && ((render_queue[last].key ^ key) & RENDER_KEY_BATCH_MASK) == 0) last++;
+			drawSprites(sprite_index, (uint)(last - i), slotTexture((uint)(key & RENDER_KEY_TEXTURE_MASK)));
+			sprite_index += (uint)(last - i);
+			i = last;
+		}
+		else {
+			drawTexturedMesh(render_queue[i].entity);
+			i++;
+		}
+	}
+	if (!post_processed)
+		post_process();
+}
+
+void RenderSystem::updateFrameUniforms(const mat3& projection)
+{
+	FrameUniforms frame;
+	for (int column = 0; column < 3; column++)
+		frame.projection[column] = vec4(projection[column], 0.f);
+	frame.screen_projection = ortho(0.0f, static_cast<float>(window_width_px), 0.0f, static_cast<float>(window_height_px));
+	frame.window_size = vec2(window_width_px, window_height_px);
+	frame.time = (float)(glfwGetTime() * 10.0f);
+	frame.padding = 0.f;
+
+	gl_state.bindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frame_ubo);
+	gl_has_errors();
 }
 
 void RenderSystem::drawImGui()
@@ -391,10 +562,57 @@ void RenderSystem::drawImGui()
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+void RenderSystem::setCullingView(vec2 camera_center)
+{
+	vec2 window_size = vec2(window_width_px, window_height_px);
+	culling_view.min = camera_center - window_size / 2.f;
+	culling_view.max = camera_center + window_size / 2.f;
+	culling_view.center = camera_center;
+
+	// same regions screen_darken leaves visible, dim_light measures in texcoords so it is an ellipse in pixels
+	culling_view.light_radii = light_radius * window_size;
+	ScreenState& screen = registry.screenStates.get(screen_state_entity);
+	culling_view.spotlight = screen.apply_spotlight;
+	culling_view.spotlight_radius = screen.spotlight_radius * std::max(window_size.x, window_size.y) * 0.75f;
+}
+
+bool RenderSystem::isVisible(Entity entity, bool lit)
+{
+	Position& position = registry.positions.get(entity);
+	vec2 center = interpolatedPosition(entity);
+	vec2 half = abs(position.scale) / 2.f;
+	// a rotated quad stays within the circle around its corners
+	if (position.angle != 0.f) half = vec2(length(half));
+	vec2 box_min = center - half;
+	vec2 box_max = center + half;
+
+	bool visible = box_min.x <= culling_view.max.x && box_max.x >= culling_view.min.x &&
+		box_min.y <= culling_view.max.y && box_max.y >= culling_view.min.y;
+	if (visible && lit) {
+		// the closest point of the box to the screen centre has to be lit
+		vec2 closest = clamp(culling_view.center, box_min, box_max) - culling_view.center;
+		vec2 in_ellipse = closest / culling_view.light_radii;
+		visible = dot(in_ellipse, in_ellipse) <= 1.f &&
+			(!culling_view.spotlight || length(closest) < culling_view.spotlight_radius);
+	}
+
+	if (visible) perf_stats.render_drawn++;
+	else perf_stats.render_culled++;
+	return visible;
+}
+
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw()
+void RenderSystem::draw(float alpha)
 {
+	interpolation_alpha = alpha;
+	perf_stats.draw_calls = 0;
+	perf_stats.render_drawn = 0;
+	perf_stats.render_culled = 0;
+	// ImGui and the previous frame may have changed anything since the cache last saw it
+	gl_state.invalidate();
+	gl_state.resetCounters();
+
 	// Getting size of window
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
@@ -404,13 +622,13 @@ void RenderSystem::draw()
 	gl_has_errors();
 
 	// Clearing backbuffer
-	glViewport(0, 0, w, h);
+	gl_state.viewport(0, 0, w, h);
 	glDepthRange(0.00001, 10);
 	glClearColor(0, 0, 0, 1.0);
 	glClearDepth(10.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state.setBlend(true);
+	gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
 	// and alpha blending, one would have to sort
 	// sprites back to front
@@ -419,78 +637,45 @@ void RenderSystem::draw()
 	// get to players position
 	assert(registry.players.size() >= 1);
 	Entity entity = registry.players.entities[0];
-	Position& player_pos = registry.positions.get(entity);
 
 	// center the camera on the player (or life orb if specified)
 	Camera camera;
+	vec2 camera_center;
 	if (registry.lifeOrbs.size() > 0 && registry.lifeOrbs.components[0].centered_on_screen) {
-		camera.centerAt(registry.positions.get(registry.lifeOrbs.entities[0]).position);
+		camera_center = interpolatedPosition(registry.lifeOrbs.entities[0]);
 	}
 	else {
-		camera.centerAt(player_pos.position);
+		camera_center = interpolatedPosition(entity);
 	}
+	camera.centerAt(camera_center);
+	updateFrameUniforms(camera.projectionMat);
+	setCullingView(camera_center);
 
-	// Handle drawing floors first
-	for (Entity entity : registry.floors.entities) {
-		drawTexturedMesh(entity, camera.projectionMat);
-	}
+	// Floors, shadows, the world and the HUD in one sorted queue, the lighting pass happens on the way
+	buildRenderQueue();
+	drawRenderQueue();
 
-	// Handle all shadows next
-	for (Entity entity : registry.shadows.entities) {
-		drawTexturedMesh(entity, camera.projectionMat);
-	}
-
-	// Draw all textured meshes that have a position and size component
-	for (Entity entity : registry.renderRequests.entities)
-	{
-		if (!registry.positions.has(entity) || registry.texts.has(entity) || 
-			registry.shadows.has(entity) || registry.floors.has(entity) ||
-			registry.projectileSelectDisplays.has(entity) || registry.healthBars.has(entity) ||
-			registry.manaBars.has(entity) || registry.powerUpIndicators.has(entity))
-			continue;
-		// Note, its not very efficient to access elements indirectly via the entity
-		// albeit iterating through all Sprites in sequence. A good point to optimize
-		drawTexturedMesh(entity, camera.projectionMat);
-	}
-	
-	// Truely render to the screen
-	drawToScreen();
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	// We do this after post processing the lighting effect
-	if (registry.cutscenes.size() == 0) {
-		for (Entity entity : registry.healthBars.entities) {
-			drawTexturedMesh(entity, camera.projectionMat);
-		}
-
-		for (Entity entity : registry.manaBars.entities) {
-			drawTexturedMesh(entity, camera.projectionMat);
-		}
-	}
-
-	for (Entity entity : registry.texts.entities)
-	{
-		drawText(entity);
-	}
+	drawTexts();
 
 	if (registry.cutscenes.size() == 0) {
 		for (Entity entity : registry.projectileSelectDisplays.entities) {
-			drawArsenal(entity, camera.projectionMat);
+			drawArsenal(entity);
 
 			ProjectileSelectDisplay& selectDisplay = registry.projectileSelectDisplays.get(entity);
 			PowerUp& powerUp = registry.powerUps.components[0]; // lowkey unsafe
 
-			if (powerUp.fasterMovement) drawTexturedMesh(selectDisplay.fasterMovement, camera.projectionMat);
+			if (powerUp.fasterMovement) drawTexturedMesh(selectDisplay.fasterMovement);
 			for (int i = 0; i < 4; i++) {
-				if (powerUp.increasedDamage[i]) drawTexturedMesh(selectDisplay.increasedDamage[i], camera.projectionMat);
-				if (powerUp.tripleShot[i]) drawTexturedMesh(selectDisplay.tripleShot[i], camera.projectionMat);
-				if (powerUp.bounceOffWalls[i]) drawTexturedMesh(selectDisplay.bounceOffWalls[i], camera.projectionMat);
+				if (powerUp.increasedDamage[i]) drawTexturedMesh(selectDisplay.increasedDamage[i]);
+				if (powerUp.tripleShot[i]) drawTexturedMesh(selectDisplay.tripleShot[i]);
+				if (powerUp.bounceOffWalls[i]) drawTexturedMesh(selectDisplay.bounceOffWalls[i]);
 			}
 		}
 	}
   
+	perf_stats.gl_state_issued = gl_state.issued();
+	perf_stats.gl_state_elided = gl_state.elided();
+
 	// Render ImGui to screen
 	drawImGui();
 
@@ -499,81 +684,70 @@ void RenderSystem::draw()
 	gl_has_errors();
 }
 
-void RenderSystem::drawText(Entity entity) {
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	Position& position = registry.positions.get(entity);
-
-	assert(registry.renderRequests.has(entity));
-	const RenderRequest& render_request = registry.renderRequests.get(entity);
-
-	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
+void RenderSystem::layoutText(Text& text)
+{
+	text.layout.clear();
+	int x = 0;
+	for (char c : text.text)
+	{
+		const Character& ch = Characters[(unsigned char)c < Characters.size() ? (unsigned char)c : '?'];
+		if (ch.Size.x > 0 && ch.Size.y > 0) {
+			float xpos = (float)(x + ch.Bearing.x);
+			float ypos = (float)-(ch.Size.y - ch.Bearing.y);
+			float w = (float)ch.Size.x;
+			float h = (float)ch.Size.y;
+			vec2 uv_min = vec2(ch.UVRect.x, ch.UVRect.y);
+			vec2 uv_max = uv_min + vec2(ch.UVRect.z, ch.UVRect.w);
+
+			vec4 quad[6] = {
+				{ xpos,     ypos + h,   uv_min.x, uv_min.y },
+				{ xpos,     ypos,       uv_min.x, uv_max.y },
+				{ xpos + w, ypos,       uv_max.x, uv_max.y },
+
+				{ xpos,     ypos + h,   uv_min.x, uv_min.y },
+				{ xpos + w, ypos,       uv_max.x, uv_max.y },
+				{ xpos + w, ypos + h,   uv_max.x, uv_min.y }
+			};
+			text.layout.insert(text.layout.end(), quad, quad + 6);
+		}
+		// now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+		x += ch.Advance >> 6; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
+	}
+	text.layout_text = text.text;
+}
 
-	// Setting shaders
-	glUseProgram(program);
+void RenderSystem::drawTexts() {
+	// place every text's cached glyph quads, only texts that changed are laid out again
+	text_vertices.clear();
+	for (uint i = 0; i < registry.texts.size(); i++)
+	{
+		Text& text = registry.texts.components[i];
+		if (text.layout_text != text.text)
+			layoutText(text);
+		Position& position = registry.positions.get(registry.texts.entities[i]);
+		float scale = position.scale.x;
+		for (const vec4& vertex : text.layout)
+			text_vertices.push_back({ position.position + vec2(vertex.x, vertex.y) * scale, vec2(vertex.z, vertex.w), text.color });
+	}
+	if (text_vertices.empty())
+		return;
+
+	gl_state.setBlend(true);
+	gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state.useProgram(effects[(GLuint)EFFECT_ASSET_ID::TEXT_2D]);
+	gl_state.bindVertexArray(vertex_arrays[(GLuint)GEOMETRY_BUFFER_ID::TEXT_2D]);
+	gl_state.bindTexture(0, glyph_atlas);
 	gl_has_errors();
 
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
+	// orphan the old contents so the upload does not wait on last frame's draw, growing when needed
+	gl_state.bindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::TEXT_2D]);
+	text_buffer_capacity = std::max(text_buffer_capacity, text_vertices.size());
+	glBufferData(GL_ARRAY_BUFFER, text_buffer_capacity * sizeof(TextVertex), nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, text_vertices.size() * sizeof(TextVertex), text_vertices.data());
 
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	Text& text_component = registry.texts.get(entity);
-	float scale = position.scale.x;
-	std::string text = text_component.text;
-	vec3 color = text_component.color;
-	GLint vertex_loc = glGetAttribLocation(program, "vertex");
-	glEnableVertexAttribArray(vertex_loc);
-	glVertexAttribPointer(vertex_loc, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-
-	glUniform3f(glGetUniformLocation(program, "textColor"), color.x, color.y, color.z);
-	glActiveTexture(GL_TEXTURE0);
-	// iterate through all characters
-	std::string::const_iterator c;
-	float x = position.position.x;
-	float y = position.position.y;
-	for (c = text.begin(); c != text.end(); c++)
-	{
-		Character ch = Characters[*c];
-
-		float xpos = x + ch.Bearing.x * scale;
-		float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-		float w = ch.Size.x * scale;
-		float h = ch.Size.y * scale;
-
-		// update VBO for each character
-		float vertices[6][4] = {
-			{ xpos,     ypos + h,   0.0f, 0.0f },
-			{ xpos,     ypos,       0.0f, 1.0f },
-			{ xpos + w, ypos,       1.0f, 1.0f },
-
-			{ xpos,     ypos + h,   0.0f, 0.0f },
-			{ xpos + w, ypos,       1.0f, 1.0f },
-			{ xpos + w, ypos + h,   1.0f, 0.0f }
-		};
-		// render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-		// render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		// now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-		x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
-	}
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	mat4 text_projection = ortho(0.0f, static_cast<float>(window_width_px), 0.0f, static_cast<float>(window_height_px));
-	glUniformMatrix4fv(glGetUniformLocation(currProgram, "projection"), 1, GL_FALSE, (float*)&text_projection);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)text_vertices.size());
+	perf_stats.draw_calls++;
 	gl_has_errors();
-	return;
 }
 
 void RenderSystem::animation_step(float elapsed_ms)
@@ -6,16 +6,77 @@
 #include "common.hpp"
 
 #include "components.hpp"
+#include "gl_state_cache.hpp"
+#include "texture_atlas.hpp"
 #include "tiny_ecs.hpp"
 
 // Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-	GLuint TextureID;  // ID handle of the glyph texture
+	vec4    UVRect;    // Offset and size of the glyph within the glyph atlas
 	ivec2   Size;      // Size of glyph
 	ivec2   Bearing;   // Offset from baseline to left/top of glyph
 	unsigned int Advance;   // Horizontal offset to advance to next glyph
 };
 
+// One vertex of the text pass, position and texcoord are read together as the vec4 vertex of text_2d.vs.glsl
+struct TextVertex {
+	vec2 position;
+	vec2 texcoord;
+	vec3 color;
+};
+
+// One sprite of the batched sprite pass, laid out as the per-instance attributes of sprite_batch.vs.glsl
+struct SpriteInstance {
+	mat3 transform;
+	vec4 uv_rect; // offset and size of the sprite's region of its texture
+	vec3 color;
+	float rainbow;
+};
+
+// Stages of a frame in draw order, HUD comes after the lighting post-process
+enum class RENDER_PASS {
+	FLOOR = 0,
+	SHADOW = 1,
+	TERRAIN = 2,
+	WORLD = 3,
+	HUD = 4
+};
+
+// One draw of the frame. The key orders the render queue and decides which neighbours share a batch,
+// from the most significant bits: pass (4), layer (8), depth (24), effect (8), texture (20)
+struct RenderItem {
+	uint64_t key;
+	Entity entity;
+};
+
+// Attribute locations every effect is linked with, so a geometry's vertex array works with any effect
+enum ATTRIBUTE_LOCATION {
+	ATTRIBUTE_POSITION = 0, // in_position, or vertex for text
+	ATTRIBUTE_TEXCOORD = 1,
+	ATTRIBUTE_COLOR = 2
+};
+
+// Uniform locations of an effect, looked up once when it is loaded, -1 where it has none
+struct EffectLocations {
+	GLint transform, fcolor, atlas_rect;
+	GLint fraction, logo_ratio, bar_ratio;
+	GLint frame_col, frame_row, frame_width, frame_height, rainbow_enabled;
+	GLint x_scale, y_scale;
+	GLint change;
+	GLint light_radius, screen_darken_factor, radius, apply_spotlight;
+};
+
+// Data every effect shares, uploaded once per frame. Matches the std140 FrameData block in the shaders,
+// where a mat3 takes three vec4 columns.
+struct FrameUniforms {
+	vec4 projection[3];
+	mat4 screen_projection; // pixels to clip space, for text
+	vec2 window_size;
+	float time;
+	float padding;
+};
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
 class RenderSystem {
@@ -26,8 +87,21 @@ class RenderSystem {
 	 * Whenever possible, add to these lists instead of creating dynamic state
 	 * it is easier to debug and faster to execute for the computer.
 	 */
-	std::array<GLuint, texture_count> texture_gl_handles;
+	std::array<GLuint, texture_count> texture_gl_handles; // the atlas page for textures packed in one
 	std::array<ivec2, texture_count> texture_dimensions;
+	// Where each texture sits within the GL texture it is bound as, all of it unless it was packed in an atlas page
+	std::array<vec4, texture_count> texture_uv_rects;
+	std::array<int, texture_count> texture_atlas_pages; // -1 for textures with a GL texture of their own
+	std::vector<GLuint> atlas_page_handles;
+
+	// Textures drawn with the repeat effect wrap around, so they stay out of the atlas
+	const std::array<TEXTURE_ASSET_ID, 5> repeating_textures = {
+		TEXTURE_ASSET_ID::NORTH_TERRAIN,
+		TEXTURE_ASSET_ID::SOUTH_TERRAIN,
+		TEXTURE_ASSET_ID::SIDE_TERRAIN,
+		TEXTURE_ASSET_ID::GENERIC_TERRAIN,
+		TEXTURE_ASSET_ID::FLOOR
+	};
 
 	// Make sure these paths remain in sync with the associated enumerators.
 	// Associated id with .obj path
@@ -90,6 +164,8 @@ class RenderSystem {
 	};
 
 	std::array<GLuint, effect_count> effects;
+	std::array<EffectLocations, effect_count> effect_locations;
+	GLuint frame_ubo;
 	// Make sure these paths remain in sync with the associated enumerators.
 	const std::array<std::string, effect_count> effect_paths = {
 		shader_path("aria"),
@@ -102,17 +178,37 @@ class RenderSystem {
 		shader_path("resource_bar"),
 		shader_path("text_2d"),
 		shader_path("animated"),
-		shader_path("shadow")
+		shader_path("shadow"),
+		shader_path("sprite_batch")
 	};
 
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
+	std::array<GLuint, geometry_count> vertex_arrays; // each with its buffers and attribute layout bound
+	std::array<GLsizei, geometry_count> index_counts;
 	std::array<Mesh, geometry_count> meshes;
 
 	std::array<SpriteSheet, sprite_sheet_count> sprite_sheets;
 
-	GLuint vao;
-	std::unordered_map<GLchar, Character> Characters;
+	// Texcoord offset and size of each textured quad geometry, zero sized for geometry the sprite batch can't draw
+	std::array<vec4, geometry_count> sprite_uv_rects;
+
+	// Sprites of the current frame in queue order, each run of them on one texture is a single instanced call
+	GLuint sprite_batch_vao;
+	GLuint sprite_instance_vbo;
+	std::vector<SpriteInstance> sprite_instances;
+
+	// Everything the frame draws up to the HUD, kept in last frame's order so sorting it again is close to linear
+	std::vector<RenderItem> render_queue;
+	uint render_frame = 0;
+
+	// Every bind of the draw path goes through here so repeated ones are skipped
+	GLStateCache gl_state;
+	// ASCII glyphs, all rasterized into one texture so every text is drawn together
+	std::array<Character, 128> Characters;
+	GLuint glyph_atlas;
+	std::vector<TextVertex> text_vertices;
+	size_t text_buffer_capacity = 0; // in vertices
 
 public:
 	// Initialize the window
@@ -132,6 +228,9 @@ public:
 	SpriteSheet& getSpriteSheet(SPRITE_SHEET_DATA_ID id) { return sprite_sheets[(int)id]; };
 
 	void initializeGlGeometryBuffers();
+
+	void initializeSpriteBatch();
+
 	// Initialize the screen texture used as intermediate render target
 	// The draw loop first renders to this texture, then it is used for the water
 	// shader
@@ -144,18 +243,59 @@ public:
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
 
-	// Draw all entities
-	void draw();
+	// Draw all entities, alpha is how far the frame is between the previous and current simulation tick
+	void draw(float alpha = 1.f);
 
 	void animation_step(float elapsed_ms);
 
 private:
+	// Fraction of a simulation tick the current frame is ahead of the last completed tick
+	float interpolation_alpha = 1.f;
+	vec2 interpolatedPosition(Entity entity);
+
 	// Internal drawing functions for each entity type
-	void drawTexturedMesh(Entity entity, const mat3& projection);
+	void drawTexturedMesh(Entity entity);
 	void drawToScreen();
-	void drawText(Entity entity);
+	void drawTexts();
+	// Lays the text out as glyph quads relative to its origin, kept on the component until the text changes
+	void layoutText(Text& text);
 	void drawImGui();
-	void drawArsenal(Entity entity, const mat3& projection);
+	void updateFrameUniforms(const mat3& projection);
+	void drawArsenal(Entity entity);
+
+	// Render queue, filled and sorted once per frame then drawn in order
+	void buildRenderQueue();
+	void sortRenderQueue(size_t num_kept);
+	void drawRenderQueue();
+	// Which pass the entity is drawn in, false for entities drawn outside the queue (text and the arsenal)
+	bool renderPass(Entity entity, RENDER_PASS& pass);
+	// Whether the entity is drawn this frame at all
+	bool inFrame(Entity entity, RENDER_PASS pass);
+	uint64_t renderKey(Entity entity, RENDER_PASS pass);
+	// Dense id of the GL texture the asset is bound as, atlas pages first
+	uint textureSlot(TEXTURE_ASSET_ID texture);
+	GLuint slotTexture(uint slot);
+
+	// Plain and animated sprites on quad geometry are drawn through the sprite batch
+	bool isBatchedSprite(const RenderRequest& render_request);
+	SpriteInstance spriteInstance(Entity entity);
+	void drawSprites(uint first, uint count, GLuint texture);
+
+	// Part of the world that can end up on screen this frame, in world pixels
+	struct CullingView {
+		vec2 min, max; // camera rectangle
+		vec2 center;
+		vec2 light_radii; // semi-axes of the ellipse dim_light leaves lit around the screen centre
+		bool spotlight;
+		float spotlight_radius;
+	};
+	CullingView culling_view;
+	void setCullingView(vec2 camera_center);
+	// Whether the entity's bounds touch the camera rectangle and, when lit is set (everything drawn
+	// before the lighting pass), the lit part of it. Counts the entity as drawn or culled.
+	bool isVisible(Entity entity, bool lit);
+	// Maps a rect in a texture's own texcoords to the texcoords of the GL texture it is bound as
+	vec4 atlasUVRect(TEXTURE_ASSET_ID texture, vec4 uv_rect);
 
 	// Helper functions for initializeSpriteSheets()
 	void initializePowerUpBlockSpriteSheet();
@@ -179,6 +319,7 @@ private:
 	void initializeExitDoorGeometryBuffer();
 	void initializeResourceBarGeometryBuffer();
 	void initializeSpriteSheetGeometryBuffer(GEOMETRY_BUFFER_ID geom_buffer_id, SPRITE_SHEET_DATA_ID ss_id);
+	void setSpriteUVRect(GEOMETRY_BUFFER_ID gid, const std::vector<TexturedVertex>& quad);
 
 	// Window handle
 	GLFWwindow* window;
@@ -1,7 +1,9 @@
 // internal
 #include "render_system.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <fstream>
 
 #include "../ext/stb_image/stb_image.h"
@@ -20,6 +22,10 @@
 	#define FONT_PATH "../../../data/fonts/PixeloidSans.ttf"
 #endif
 
+// The glyph atlas is one fixed width, as tall as the 48px glyphs need
+const int GLYPH_ATLAS_WIDTH = 1024;
+const int GLYPH_ATLAS_PADDING = 1;
+
 // World initialization
 bool RenderSystem::init(GLFWwindow* window_arg)
 {
@@ -55,17 +61,12 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 	// code to use OpenGL 4.3 (not suported on mac) and add additional .h and .cpp
 	// glDebugMessageCallback((GLDEBUGPROC)errorCallback, nullptr);
 
-	// We are not really using VAO's but without at least one bound we will crash in
-	// some systems.
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	gl_has_errors();
-
 	initScreenTexture();
     initializeGlTextures();
 	initializeGlEffects();
 	initializeSpriteSheets(); // must be called before initializeGlGeometryBuffers()
 	initializeGlGeometryBuffers();
+	initializeSpriteBatch(); // must be called after initializeGlGeometryBuffers()
 	initializeImGui();
 	initializeFreeType();
 
@@ -92,54 +93,75 @@ void RenderSystem::initializeFreeType() {
 		// set size to load glyphs as
 		FT_Set_Pixel_Sizes(face, 0, 48);
 
-		// disable byte-alignment restriction
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-		// load first 128 characters of ASCII set
-		for (unsigned char c = 0; c < 128; c++)
+		// load first 128 characters of ASCII set, packed into shelves of a single texture
+		std::vector<std::vector<unsigned char>> bitmaps(Characters.size());
+		ivec2 cursor = { GLYPH_ATLAS_PADDING, GLYPH_ATLAS_PADDING };
+		int shelf_height = 0;
+		for (unsigned char c = 0; c < Characters.size(); c++)
 		{
 			// Load character glyph 
 			if (FT_Load_Char(face, c, FT_LOAD_RENDER))
 			{
 				std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+				Characters[c] = Character();
 				continue;
 			}
-			// generate texture
-			GLuint texture;
-			glGenTextures(1, &texture);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glTexImage2D(
-				GL_TEXTURE_2D,
-				0,
-				GL_RED,
-				face->glyph->bitmap.width,
-				face->glyph->bitmap.rows,
-				0,
-				GL_RED,
-				GL_UNSIGNED_BYTE,
-				face->glyph->bitmap.buffer
-			);
-			// set texture options
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			// now store character for later use
+			const FT_Bitmap& bitmap = face->glyph->bitmap;
+			ivec2 size = ivec2(bitmap.width, bitmap.rows);
+			if (cursor.x + size.x + GLYPH_ATLAS_PADDING > GLYPH_ATLAS_WIDTH) {
+				cursor = { GLYPH_ATLAS_PADDING, cursor.y + shelf_height + GLYPH_ATLAS_PADDING };
+				shelf_height = 0;
+			}
+			// keep the glyph's rows tightly packed, pitch may include padding of its own
+			bitmaps[c].resize(size.x * size.y);
+			for (int row = 0; row < size.y; row++)
+				memcpy(&bitmaps[c][row * size.x], bitmap.buffer + row * bitmap.pitch, size.x);
+
+			// store character for later use, its texcoords are relative to the atlas once its height is known
 			Character character = {
-				texture,
-				glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+				vec4(cursor, size),
+				size,
 				glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
 				static_cast<unsigned int>(face->glyph->advance.x)
 			};
-			Characters.insert(std::pair<char, Character>(c, character));
+			Characters[c] = character;
+			cursor.x += size.x + GLYPH_ATLAS_PADDING;
+			shelf_height = std::max(shelf_height, size.y);
+		}
+
+		// copy every glyph into the atlas, empty texels stay 0 so filtering never picks up a neighbour
+		ivec2 atlas_size = ivec2(GLYPH_ATLAS_WIDTH, cursor.y + shelf_height + GLYPH_ATLAS_PADDING);
+		std::vector<unsigned char> atlas_pixels(atlas_size.x * atlas_size.y, 0);
+		for (uint c = 0; c < Characters.size(); c++) {
+			Character& character = Characters[c];
+			ivec2 offset = ivec2(character.UVRect.x, character.UVRect.y);
+			for (int row = 0; row < character.Size.y; row++)
+				memcpy(&atlas_pixels[(offset.y + row) * atlas_size.x + offset.x], &bitmaps[c][row * character.Size.x], character.Size.x);
+			character.UVRect /= vec4(atlas_size, atlas_size);
 		}
+
+		// disable byte-alignment restriction
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glGenTextures(1, &glyph_atlas);
+		glBindTexture(GL_TEXTURE_2D, glyph_atlas);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlas_size.x, atlas_size.y, 0, GL_RED, GL_UNSIGNED_BYTE, atlas_pixels.data());
+		// set texture options
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	}
 	// destroy FreeType once we're finished
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
 
+	// the glyph quads of every text, as two triangles each, rewritten every frame by drawTexts
+	glBindVertexArray(vertex_arrays[(uint)GEOMETRY_BUFFER_ID::TEXT_2D]);
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)GEOMETRY_BUFFER_ID::TEXT_2D]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	glVertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, position));
+	glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+	glVertexAttribPointer(ATTRIBUTE_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, color));
 
 	gl_has_errors();
 }
@@ -168,10 +190,54 @@ void RenderSystem::initializeImGui()
 
 void RenderSystem::initializeGlTextures()
 {
-    glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	// pack everything but the wrapping textures into the atlas, it is only repacked when an image changes
+	std::vector<std::string> atlas_sources;
+	std::vector<uint> atlas_textures;
+	for (uint i = 0; i < texture_paths.size(); i++) {
+		if (std::find(repeating_textures.begin(), repeating_textures.end(), (TEXTURE_ASSET_ID)i) != repeating_textures.end())
+			continue;
+		atlas_sources.push_back(texture_paths[i]);
+		atlas_textures.push_back(i);
+	}
+	TextureAtlas atlas;
+	if (!atlas.build(atlas_sources, data_path() + "/texture_atlas.cache"))
+	{
+		fprintf(stderr, "Could not build the texture atlas.");
+		assert(false);
+	}
+
+	atlas_page_handles.resize(atlas.pages().size());
+	glGenTextures((GLsizei)atlas_page_handles.size(), atlas_page_handles.data());
+	for (uint p = 0; p < atlas.pages().size(); p++)
+	{
+		const TextureAtlas::Page& page = atlas.pages()[p];
+		glBindTexture(GL_TEXTURE_2D, atlas_page_handles[p]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page.size.x, page.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, page.pixels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		gl_has_errors();
+	}
+	atlas.release_pixels();
+
+	texture_uv_rects.fill(vec4(0.f, 0.f, 1.f, 1.f));
+	texture_atlas_pages.fill(-1);
+	for (uint k = 0; k < atlas_textures.size(); k++)
+	{
+		const TextureAtlas::Region& region = atlas.region(k);
+		if (region.page < 0) continue;
+		uint i = atlas_textures[k];
+		texture_gl_handles[i] = atlas_page_handles[region.page];
+		texture_dimensions[i] = region.size;
+		texture_uv_rects[i] = region.uv_rect;
+		texture_atlas_pages[i] = region.page;
+	}
 
-    for(uint i = 0; i < texture_paths.size(); i++)
-    {
+	// the rest get a texture of their own
+	for(uint i = 0; i < texture_paths.size(); i++)
+	{
+		if (texture_atlas_pages[i] >= 0) continue;
 		const std::string& path = texture_paths[i];
 		ivec2& dimensions = texture_dimensions[i];
 
@@ -184,13 +250,14 @@ void RenderSystem::initializeGlTextures()
 			fprintf(stderr, "%s", message.c_str());
 			assert(false);
 		}
+		glGenTextures(1, &texture_gl_handles[i]);
 		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		gl_has_errors();
 		stbi_image_free(data);
-    }
+	}
 }
 
 void RenderSystem::initializeGlEffects()
@@ -202,13 +269,71 @@ void RenderSystem::initializeGlEffects()
 
 		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
 		assert(is_valid && (GLuint)effects[i] != 0);
+
+		// everything the draw calls set, so they never look a location up by name
+		const GLuint program = effects[i];
+		EffectLocations& locations = effect_locations[i];
+		locations.transform = glGetUniformLocation(program, "transform");
+		locations.fcolor = glGetUniformLocation(program, "fcolor");
+		locations.atlas_rect = glGetUniformLocation(program, "atlas_rect");
+		locations.fraction = glGetUniformLocation(program, "fraction");
+		locations.logo_ratio = glGetUniformLocation(program, "logoRatio");
+		locations.bar_ratio = glGetUniformLocation(program, "barRatio");
+		locations.frame_col = glGetUniformLocation(program, "frame_col");
+		locations.frame_row = glGetUniformLocation(program, "frame_row");
+		locations.frame_width = glGetUniformLocation(program, "frame_width");
+		locations.frame_height = glGetUniformLocation(program, "frame_height");
+		locations.rainbow_enabled = glGetUniformLocation(program, "rainbow_enabled");
+		locations.x_scale = glGetUniformLocation(program, "x_scale");
+		locations.y_scale = glGetUniformLocation(program, "y_scale");
+		locations.change = glGetUniformLocation(program, "change");
+		locations.light_radius = glGetUniformLocation(program, "light_radius");
+		locations.screen_darken_factor = glGetUniformLocation(program, "screen_darken_factor");
+		locations.radius = glGetUniformLocation(program, "radius");
+		locations.apply_spotlight = glGetUniformLocation(program, "apply_spotlight");
+
+		GLuint block_index = glGetUniformBlockIndex(program, "FrameData");
+		if (block_index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, block_index, FRAME_UNIFORMS_BINDING);
+		gl_has_errors();
 	}
+
+	glGenBuffers(1, &frame_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frame_ubo);
+	gl_has_errors();
+}
+
+// Attribute layout of each kind of vertex, for the vertex array of the bound buffer
+void setVertexLayout(const TexturedVertex*)
+{
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
+	glEnableVertexAttribArray(ATTRIBUTE_TEXCOORD);
+	glVertexAttribPointer(ATTRIBUTE_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+}
+
+void setVertexLayout(const ColoredVertex*)
+{
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)0);
+	glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+	glVertexAttribPointer(ATTRIBUTE_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)sizeof(vec3));
+}
+
+void setVertexLayout(const vec3*)
+{
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
 }
 
 // One could merge the following two functions as a template function...
 template <class T>
 void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices)
 {
+	// the index buffer binding is recorded in the vertex array, so it has to be bound first
+	glBindVertexArray(vertex_arrays[(uint)gid]);
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)gid]);
 	glBufferData(GL_ARRAY_BUFFER,
 		sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
@@ -217,6 +342,10 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)gid]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	index_counts[(uint)gid] = (GLsizei)indices.size();
+	gl_has_errors();
+
+	setVertexLayout(vertices.data());
 	gl_has_errors();
 }
 
@@ -478,6 +607,7 @@ void RenderSystem::initializePlayerGeometryBuffer()
 	meshes[geom_index].vertices = vertices;
 	meshes[geom_index].vertex_indices = textured_indices;
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::PLAYER, textured_vertices, textured_indices);
+	setSpriteUVRect(GEOMETRY_BUFFER_ID::PLAYER, textured_vertices);
 }
 
 void RenderSystem::initializeSmallEnemyGeometryBuffer()
@@ -543,6 +673,7 @@ void RenderSystem::initializeSmallEnemyGeometryBuffer()
 		meshes[geom_index].vertices = vertices;
 		meshes[geom_index].vertex_indices = textured_indices;
 		bindVBOandIBO((GEOMETRY_BUFFER_ID)geom_index, textured_vertices, textured_indices);
+		setSpriteUVRect((GEOMETRY_BUFFER_ID)geom_index, textured_vertices);
 	}
 }
 
@@ -572,6 +703,7 @@ void RenderSystem::initializeSpriteGeometryBuffer()
 	meshes[geom_index].vertices = vertices;
 	meshes[geom_index].vertex_indices = textured_indices;
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::SPRITE, textured_vertices, textured_indices);
+	setSpriteUVRect(GEOMETRY_BUFFER_ID::SPRITE, textured_vertices);
 }
 
 void RenderSystem::initializeDebugLineGeometryBuffer()
@@ -676,6 +808,7 @@ void RenderSystem::initializeSpriteSheetGeometryBuffer(GEOMETRY_BUFFER_ID geom_b
 	meshes[geom_index].vertices = vertices;
 	meshes[geom_index].vertex_indices = textured_indices;
 	bindVBOandIBO(geom_buffer_id, textured_vertices, textured_indices);
+	setSpriteUVRect(geom_buffer_id, textured_vertices);
 }
 
 void RenderSystem::initializeResourceBarGeometryBuffer()
@@ -707,12 +840,25 @@ void RenderSystem::initializeResourceBarGeometryBuffer()
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::RESOURCE_BAR, textured_vertices, textured_indices);
 }
 
+// Quads are laid out top left, top right, bottom right, bottom left, so the bottom left and top right
+// texcoords span the region of the texture the quad shows
+void RenderSystem::setSpriteUVRect(GEOMETRY_BUFFER_ID gid, const std::vector<TexturedVertex>& quad)
+{
+	assert(quad.size() == 4);
+	sprite_uv_rects[(int)gid] = vec4(quad[3].texcoord, quad[1].texcoord - quad[3].texcoord);
+}
+
 void RenderSystem::initializeGlGeometryBuffers()
 {
+	sprite_uv_rects.fill(vec4(0.f));
+
 	// Vertex Buffer creation.
 	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	// Vertex Array creation, filled in along with the buffers
+	glGenVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	index_counts.fill(0);
 
 	// Index and Vertex buffer data initialization.
 	initializeGlMeshes();
@@ -746,13 +892,40 @@ void RenderSystem::initializeGlGeometryBuffers()
 	initializeResourceBarGeometryBuffer();
 }
 
+// The sprite batch draws the SPRITE quad once per instance, reading the rest from a per-frame instance buffer
+void RenderSystem::initializeSpriteBatch()
+{
+	glGenVertexArrays(1, &sprite_batch_vao);
+	glGenBuffers(1, &sprite_instance_vbo);
+	glBindVertexArray(sprite_batch_vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+	setVertexLayout((const TexturedVertex*)nullptr);
+
+	// locations 2 to 7 advance once per instance, their pointers are set per batch in drawSprites
+	glBindBuffer(GL_ARRAY_BUFFER, sprite_instance_vbo);
+	for (GLuint loc = 2; loc <= 7; loc++) {
+		glEnableVertexAttribArray(loc);
+		glVertexAttribDivisor(loc, 1);
+	}
+	gl_has_errors();
+}
+
 RenderSystem::~RenderSystem()
 {
 	// Don't need to free gl resources since they last for as long as the program,
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
-	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	glDeleteVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	glDeleteBuffers(1, &sprite_instance_vbo);
+	glDeleteBuffers(1, &frame_ubo);
+	glDeleteVertexArrays(1, &sprite_batch_vao);
+	for (uint i = 0; i < texture_count; i++)
+		if (texture_atlas_pages[i] < 0) glDeleteTextures(1, &texture_gl_handles[i]);
+	glDeleteTextures((GLsizei)atlas_page_handles.size(), atlas_page_handles.data());
+	glDeleteTextures(1, &glyph_atlas);
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
 	gl_has_errors();
@@ -867,6 +1040,11 @@ bool loadEffectFromFile(
 	out_program = glCreateProgram();
 	glAttachShader(out_program, vertex);
 	glAttachShader(out_program, fragment);
+	// same attribute locations in every effect, names an effect doesn't use are ignored
+	glBindAttribLocation(out_program, ATTRIBUTE_POSITION, "in_position");
+	glBindAttribLocation(out_program, ATTRIBUTE_POSITION, "vertex");
+	glBindAttribLocation(out_program, ATTRIBUTE_TEXCOORD, "in_texcoord");
+	glBindAttribLocation(out_program, ATTRIBUTE_COLOR, "in_color");
 	glLinkProgram(out_program);
 	gl_has_errors();
 
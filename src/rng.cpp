@@ -0,0 +1,58 @@
+// internal
+#include "rng.hpp"
+
+RandomStreams rng;
+
+void Pcg32::seed(uint64_t seed, uint64_t sequence)
+{
+	// the increment must be odd, each sequence gives a different cycle order
+	state = 0;
+	inc = (sequence << 1) | 1;
+	(*this)();
+	state += seed;
+	(*this)();
+}
+
+Pcg32::result_type Pcg32::operator()()
+{
+	uint64_t old_state = state;
+	state = old_state * 6364136223846793005ULL + inc;
+	uint32_t xorshifted = (uint32_t)(((old_state >> 18) ^ old_state) >> 27);
+	uint32_t rot = (uint32_t)(old_state >> 59);
+	return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+}
+
+uint32_t Pcg32::below(uint32_t n)
+{
+	assert(n > 0);
+	// reject the top values that would make the low results more likely
+	uint32_t threshold = (0u - n) % n;
+	for (;;) {
+		uint32_t r = (*this)();
+		if (r >= threshold) return r % n;
+	}
+}
+
+float Pcg32::uniform(float lo, float hi)
+{
+	// top 24 bits fill a float's mantissa exactly
+	float t = ((*this)() >> 8) * (1.f / 16777216.f);
+	return lo + (hi - lo) * t;
+}
+
+// SplitMix64, spreads one seed into well mixed seeds for each stream
+uint64_t splitMix64(uint64_t& x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+void RandomStreams::seed(uint64_t seed)
+{
+	session_seed = seed;
+	uint64_t mix = seed;
+	for (unsigned int s = 0; s < RNG_STREAM_COUNT; s++)
+		streams[s].seed(splitMix64(mix), s);
+}
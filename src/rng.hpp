@@ -0,0 +1,59 @@
+#pragma once
+
+// stlib
+#include <cstdint>
+#include <cassert>
+
+// Independent sources of randomness, each has its own generator so drawing more numbers
+// from one (say a new projectile pattern) does not change what the others produce
+enum RNG_STREAM {
+	RNG_LEVEL,     // enemy types and obstacle speeds picked when a level is loaded
+	RNG_WEAKNESS,  // weakness timer lengths and elements
+	RNG_COMBAT,    // combo projectile elements and weaknesses
+	RNG_POWER_UPS, // order power ups are offered in
+	RNG_WAVES,     // survival mode enemy types and spawn points
+	RNG_STREAM_COUNT
+};
+
+// PCG32 (XSH RR), small and fast with good statistical quality. Also usable as a
+// UniformRandomBitGenerator, e.g. with std::shuffle.
+class Pcg32
+{
+public:
+	typedef uint32_t result_type;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	void seed(uint64_t seed, uint64_t sequence);
+	result_type operator()();
+
+	// Uniform integer in [0, n) and float in [lo, hi), computed the same way on every platform
+	// unlike the std distributions
+	uint32_t below(uint32_t n);
+	float uniform(float lo, float hi);
+
+private:
+	uint64_t state = 0x853c49e6748fea9bULL;
+	uint64_t inc = 0xda3e39cb94b95bdbULL;
+};
+
+// Every gameplay random number comes from one of these streams. They are all derived from
+// a single seed, so seeding with the same value reproduces a whole session.
+class RandomStreams
+{
+public:
+	void seed(uint64_t seed);
+	uint64_t current_seed() const { return session_seed; }
+
+	Pcg32& stream(RNG_STREAM stream)
+	{
+		assert(stream < RNG_STREAM_COUNT);
+		return streams[stream];
+	}
+
+private:
+	uint64_t session_seed = 0;
+	Pcg32 streams[RNG_STREAM_COUNT];
+};
+
+extern RandomStreams rng;
@@ -0,0 +1,238 @@
+// internal
+#include "spatial_grid.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <algorithm>
+#include <limits>
+
+SpatialGrid spatial_grid;
+
+// Past this many cells per axis the cells are made bigger instead
+const int MAX_GRID_DIM = 256;
+const float MIN_CELL_SIZE = 128.f;
+
+uint layerOf(Entity entity)
+{
+	if (registry.players.has(entity)) return LAYER_PLAYER;
+	if (registry.enemies.has(entity)) return LAYER_ENEMY;
+	if (registry.projectiles.has(entity))
+		return registry.projectiles.get(entity).hostile ? LAYER_ENEMY_PROJECTILE : LAYER_PLAYER_PROJECTILE;
+	if (registry.terrain.has(entity)) return LAYER_TERRAIN;
+	return LAYER_PROP;
+}
+
+bool boxesOverlap(vec2 min_1, vec2 max_1, vec2 min_2, vec2 max_2)
+{
+	return min_1.x <= max_2.x && max_1.x >= min_2.x && min_1.y <= max_2.y && max_1.y >= min_2.y;
+}
+
+// Slab test of a ray against a box, t is the distance along dir to where the ray enters the box
+bool rayIntersectsBox(vec2 origin, vec2 dir, vec2 box_min, vec2 box_max, float& t, vec2& normal)
+{
+	float t_enter = 0.f;
+	float t_exit = std::numeric_limits<float>::infinity();
+	normal = { 0.f, 0.f };
+	for (int axis = 0; axis < 2; axis++) {
+		if (dir[axis] == 0.f) {
+			if (origin[axis] < box_min[axis] || origin[axis] > box_max[axis]) return false;
+			continue;
+		}
+		float t1 = (box_min[axis] - origin[axis]) / dir[axis];
+		float t2 = (box_max[axis] - origin[axis]) / dir[axis];
+		if (t1 > t2) std::swap(t1, t2);
+		if (t1 > t_enter) {
+			t_enter = t1;
+			normal = { 0.f, 0.f };
+			normal[axis] = (dir[axis] > 0.f) ? -1.f : 1.f;
+		}
+		t_exit = std::min(t_exit, t2);
+		if (t_enter > t_exit) return false;
+	}
+	t = t_enter;
+	return true;
+}
+
+ivec2 SpatialGrid::cellOf(vec2 point) const
+{
+	ivec2 cell = ivec2(floor((point - origin) / cell_size));
+	return clamp(cell, ivec2(0, 0), dims - 1);
+}
+
+void SpatialGrid::build()
+{
+	bodies.clear();
+	vec2 world_min = vec2(std::numeric_limits<float>::max());
+	vec2 world_max = vec2(-std::numeric_limits<float>::max());
+	for (uint i = 0; i < registry.collidables.size(); i++) {
+		Entity entity = registry.collidables.entities[i];
+		if (!registry.positions.has(entity)) continue;
+		Position& position = registry.positions.get(entity);
+		vec2 half = abs(position.scale) / 2.f;
+		Body body = { entity, position.position - half, position.position + half, layerOf(entity), ivec2(0), ivec2(0) };
+		bodies.push_back(body);
+		world_min = min(world_min, body.min);
+		world_max = max(world_max, body.max);
+	}
+	if (bodies.size() == 0) {
+		dims = { 0, 0 };
+		cell_start.assign(1, 0);
+		cell_bodies.clear();
+		return;
+	}
+
+	// cover the bounds of everything, growing the cells if the world is too large for the grid
+	origin = world_min;
+	vec2 extent = world_max - world_min;
+	cell_size = std::max(MIN_CELL_SIZE, std::max(extent.x, extent.y) / MAX_GRID_DIM);
+	dims = ivec2(extent / cell_size) + 1;
+	dims = min(dims, ivec2(MAX_GRID_DIM));
+
+	// counting sort of bodies into cells, all buffers keep their capacity between builds
+	uint num_cells = dims.x * dims.y;
+	cell_start.assign(num_cells + 1, 0);
+	for (Body& body : bodies) {
+		body.cell_min = cellOf(body.min);
+		body.cell_max = cellOf(body.max);
+		for (int y = body.cell_min.y; y <= body.cell_max.y; y++)
+			for (int x = body.cell_min.x; x <= body.cell_max.x; x++)
+				cell_start[cellIndex(x, y) + 1]++;
+	}
+	for (uint c = 0; c < num_cells; c++)
+		cell_start[c + 1] += cell_start[c];
+
+	cell_bodies.resize(cell_start[num_cells]);
+	cell_fill.assign(cell_start.begin(), cell_start.end() - 1);
+	for (uint b = 0; b < bodies.size(); b++) {
+		Body& body = bodies[b];
+		for (int y = body.cell_min.y; y <= body.cell_max.y; y++)
+			for (int x = body.cell_min.x; x <= body.cell_max.x; x++)
+				cell_bodies[cell_fill[cellIndex(x, y)]++] = b;
+	}
+}
+
+// Visits every body on the masked layers whose bounds overlap the box exactly once
+template <typename Visitor>
+void SpatialGrid::visitAABB(vec2 min, vec2 max, uint layer_mask, Visitor visit) const
+{
+	if (dims.x == 0) return;
+	ivec2 query_min = cellOf(min);
+	ivec2 query_max = cellOf(max);
+	for (int y = query_min.y; y <= query_max.y; y++) {
+		for (int x = query_min.x; x <= query_max.x; x++) {
+			uint c = cellIndex(x, y);
+			for (uint i = cell_start[c]; i < cell_start[c + 1]; i++) {
+				const Body& body = bodies[cell_bodies[i]];
+				// a body spanning several cells is only reported from the first cell it shares with the query
+				if (x != std::max(body.cell_min.x, query_min.x) || y != std::max(body.cell_min.y, query_min.y)) continue;
+				if (!(body.layer & layer_mask) || !boxesOverlap(min, max, body.min, body.max)) continue;
+				if (!visit(cell_bodies[i], body)) return;
+			}
+		}
+	}
+}
+
+int SpatialGrid::query_aabb(vec2 min, vec2 max, uint layer_mask, uint* out, int max_out) const
+{
+	int count = 0;
+	visitAABB(min, max, layer_mask, [&](uint index, const Body&) {
+		if (count == max_out) return false;
+		out[count++] = index;
+		return true;
+	});
+	return count;
+}
+
+int SpatialGrid::query_radius(vec2 center, float radius, uint layer_mask, uint* out, int max_out) const
+{
+	int count = 0;
+	visitAABB(center - radius, center + radius, layer_mask, [&](uint index, const Body& body) {
+		// only bodies whose closest point is inside the circle
+		vec2 d = clamp(center, body.min, body.max) - center;
+		if (dot(d, d) > radius * radius) return true;
+		if (count == max_out) return false;
+		out[count++] = index;
+		return true;
+	});
+	return count;
+}
+
+bool SpatialGrid::raycast(vec2 ray_origin, vec2 dir, float max_dist, uint layer_mask, RaycastHit& hit) const
+{
+	if (dims.x == 0) return false;
+
+	// clip the ray to the grid so the walk below starts and ends inside it
+	float t_start;
+	vec2 normal_unused;
+	vec2 grid_max = origin + vec2(dims) * cell_size;
+	if (!rayIntersectsBox(ray_origin, dir, origin, grid_max, t_start, normal_unused) || t_start > max_dist) return false;
+
+	// walk the cells the ray passes through in order (Amanatides & Woo)
+	vec2 start = ray_origin + dir * t_start;
+	ivec2 cell = cellOf(start);
+	ivec2 step = ivec2(dir.x >= 0.f ? 1 : -1, dir.y >= 0.f ? 1 : -1);
+	vec2 t_max, t_delta;
+	for (int axis = 0; axis < 2; axis++) {
+		if (dir[axis] == 0.f) {
+			t_max[axis] = std::numeric_limits<float>::infinity();
+			t_delta[axis] = std::numeric_limits<float>::infinity();
+			continue;
+		}
+		float boundary = origin[axis] + (cell[axis] + (step[axis] > 0 ? 1 : 0)) * cell_size;
+		t_max[axis] = (boundary - ray_origin[axis]) / dir[axis];
+		t_delta[axis] = cell_size / abs(dir[axis]);
+	}
+
+	bool found = false;
+	hit.distance = max_dist;
+	while (cell.x >= 0 && cell.y >= 0 && cell.x < dims.x && cell.y < dims.y) {
+		uint c = cellIndex(cell.x, cell.y);
+		for (uint i = cell_start[c]; i < cell_start[c + 1]; i++) {
+			const Body& body = bodies[cell_bodies[i]];
+			if (!(body.layer & layer_mask)) continue;
+			float t;
+			vec2 normal;
+			if (rayIntersectsBox(ray_origin, dir, body.min, body.max, t, normal) && t <= hit.distance) {
+				hit.body = cell_bodies[i];
+				hit.distance = t;
+				hit.normal = normal;
+				found = true;
+			}
+		}
+		// nothing in a later cell can be closer than a hit that ends before this cell does
+		float t_cell_exit = std::min(t_max.x, t_max.y);
+		if ((found && hit.distance <= t_cell_exit) || t_cell_exit > max_dist) break;
+
+		if (t_max.x < t_max.y) {
+			cell.x += step.x;
+			t_max.x += t_delta.x;
+		}
+		else {
+			cell.y += step.y;
+			t_max.y += t_delta.y;
+		}
+	}
+	if (found) hit.point = ray_origin + dir * hit.distance;
+	return found;
+}
+
+void SpatialGrid::find_pairs(std::vector<std::pair<uint, uint>>& pairs) const
+{
+	pairs.clear();
+	for (int y = 0; y < dims.y; y++) {
+		for (int x = 0; x < dims.x; x++) {
+			uint c = cellIndex(x, y);
+			for (uint i = cell_start[c]; i < cell_start[c + 1]; i++) {
+				const Body& body_i = bodies[cell_bodies[i]];
+				for (uint j = i + 1; j < cell_start[c + 1]; j++) {
+					const Body& body_j = bodies[cell_bodies[j]];
+					// a pair sharing several cells is only reported from the first one they share
+					if (x != std::max(body_i.cell_min.x, body_j.cell_min.x) || y != std::max(body_i.cell_min.y, body_j.cell_min.y)) continue;
+					if (!boxesOverlap(body_i.min, body_i.max, body_j.min, body_j.max)) continue;
+					// cells are filled in body order, so cell_bodies[i] < cell_bodies[j]
+					pairs.push_back({ cell_bodies[i], cell_bodies[j] });
+				}
+			}
+		}
+	}
+}
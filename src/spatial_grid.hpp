@@ -0,0 +1,79 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+// stlib
+#include <vector>
+#include <utility>
+
+// Layers a collidable can be found on, OR them together to build a query mask
+enum COLLISION_LAYER {
+	LAYER_PLAYER = 1 << 0,
+	LAYER_ENEMY = 1 << 1,
+	LAYER_PLAYER_PROJECTILE = 1 << 2,
+	LAYER_ENEMY_PROJECTILE = 1 << 3,
+	LAYER_TERRAIN = 1 << 4,
+	LAYER_PROP = 1 << 5, // obstacles, pickups, doors, lost souls and everything else
+	LAYER_ALL = 0xFF
+};
+
+struct RaycastHit
+{
+	uint body; // index of the body that was hit, see SpatialGrid::body
+	float distance;
+	vec2 point;
+	vec2 normal;
+};
+
+// Uniform grid over every collidable, rebuilt by the physics system each step.
+// Queries write body indices into buffers provided by the caller and never allocate,
+// a body's entity, bounds and layer are then read back with body(index).
+class SpatialGrid
+{
+public:
+	struct Body
+	{
+		Entity entity;
+		vec2 min;
+		vec2 max;
+		uint layer;
+		ivec2 cell_min; // range of cells the body was inserted into
+		ivec2 cell_max;
+	};
+
+	// Rebuild the grid from the current positions of all collidables
+	void build();
+
+	// Bodies overlapping the box or circle, returns how many indices were written to out (at most max_out)
+	int query_aabb(vec2 min, vec2 max, uint layer_mask, uint* out, int max_out) const;
+	int query_radius(vec2 center, float radius, uint layer_mask, uint* out, int max_out) const;
+
+	// Closest body on the masked layers along the ray within max_dist, dir must be normalized
+	bool raycast(vec2 origin, vec2 dir, float max_dist, uint layer_mask, RaycastHit& hit) const;
+
+	// Every pair of bodies whose bounds overlap, each reported once with the lower body index first
+	void find_pairs(std::vector<std::pair<uint, uint>>& pairs) const;
+
+	const Body& body(uint index) const { return bodies[index]; }
+	uint size() const { return (uint)bodies.size(); }
+
+private:
+	template <typename Visitor>
+	void visitAABB(vec2 min, vec2 max, uint layer_mask, Visitor visit) const;
+	ivec2 cellOf(vec2 point) const;
+	uint cellIndex(int x, int y) const { return (uint)(y * dims.x + x); }
+
+	float cell_size = 128.f;
+	vec2 origin = { 0.f, 0.f };
+	ivec2 dims = { 0, 0 };
+
+	std::vector<Body> bodies;
+	// bodies of cell c are cell_bodies[cell_start[c]] .. cell_bodies[cell_start[c + 1] - 1]
+	std::vector<uint> cell_start;
+	std::vector<uint> cell_bodies;
+	std::vector<uint> cell_fill;
+};
+
+extern SpatialGrid spatial_grid;
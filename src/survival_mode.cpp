@@ -0,0 +1,206 @@
+// internal
+#include "survival_mode.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "world_init.hpp"
+#include "game_level.hpp"
+#include "projectile_pool.hpp"
+#include "rng.hpp"
+
+// stlib
+#include <algorithm>
+#include <cstdio>
+
+SurvivalMode survival;
+
+// Where sleeping enemies wait, far enough that nothing reaches them and no light is near
+const vec2 PARK_POSITION = { -100000.f, -100000.f };
+
+const uint FIRST_WAVE_ENEMIES = 16;
+const uint MAX_WAVE_ENEMIES = 4096;
+const uint MAX_LIVE_ENEMIES = 8192;
+const float WAVE_INTERVAL_MS = 12000.f;
+// once the arena is cleared the next wave comes sooner
+const float CLEARED_WAVE_DELAY_MS = 2000.f;
+// spread the spawns of a wave over several steps so it does not arrive as one spike
+const uint SPAWNS_PER_STEP = 32;
+// the run ends when the average frame stays over budget this long
+const float FRAME_BUDGET_MS = 1000.f / 60.f;
+const float OVER_BUDGET_LIMIT_MS = 2000.f;
+// weight of the newest frame in the average
+const float FRAME_SMOOTHING = 0.05f;
+
+Entity EnemyPool::acquire(RenderSystem* renderer, vec2 position, const Enemy& attributes)
+{
+	num_live++;
+	std::vector<uint>& sleeping = free_slots[attributes.type];
+	if (sleeping.size() == 0) {
+		Entity entity = createEnemy(renderer, position, attributes);
+		registry.enemies.get(entity).pool_slot = (uint)slot_entities.size();
+		slot_entities.push_back(entity);
+		slot_requests.push_back(RenderRequest());
+		slot_bar_requests.push_back(RenderRequest());
+		return entity;
+	}
+
+	uint slot = sleeping.back();
+	sleeping.pop_back();
+	Entity entity = slot_entities[slot];
+
+	Enemy& enemy = registry.enemies.emplace(entity);
+	enemy = attributes;
+	enemy.pool_slot = slot;
+	registry.collidables.emplace(entity);
+	registry.renderRequests.insert(entity, slot_requests[slot]);
+
+	Position& enemy_position = registry.positions.get(entity);
+	enemy_position.position = position;
+	enemy_position.prev_position = position;
+	registry.velocities.get(entity).velocity = { 50.f, 0.f };
+
+	Resources& resources = registry.resources.get(entity);
+	resources.currentHealth = resources.maxHealth;
+	registry.healthBars.emplace(resources.healthBar).owner = entity;
+	registry.renderRequests.insert(resources.healthBar, slot_bar_requests[slot]);
+	return entity;
+}
+
+void EnemyPool::release(Entity enemy)
+{
+	if (!registry.enemies.has(enemy)) return;
+	const Enemy& attributes = registry.enemies.get(enemy);
+	uint slot = attributes.pool_slot;
+	Entity health_bar = registry.resources.get(enemy).healthBar;
+	if (attributes.type >= ElementType::COUNT || slot >= slot_entities.size() || (uint)slot_entities[slot] != (uint)enemy) {
+		registry.remove_all_components_of(health_bar);
+		registry.remove_all_components_of(enemy);
+		return;
+	}
+
+	free_slots[attributes.type].push_back(slot);
+	slot_requests[slot] = registry.renderRequests.get(enemy);
+	slot_bar_requests[slot] = registry.renderRequests.get(health_bar);
+	registry.enemies.remove(enemy);
+	registry.collidables.remove(enemy);
+	registry.renderRequests.remove(enemy);
+	// a bar left in the render queue would be drawn without the HealthBar it reads
+	registry.healthBars.remove(health_bar);
+	registry.renderRequests.remove(health_bar);
+
+	Position& position = registry.positions.get(enemy);
+	position.position = PARK_POSITION;
+	position.prev_position = PARK_POSITION;
+	registry.velocities.get(enemy).velocity = { 0.f, 0.f };
+	num_live--;
+}
+
+void EnemyPool::clear()
+{
+	slot_entities.clear();
+	slot_requests.clear();
+	slot_bar_requests.clear();
+	for (std::vector<uint>& sleeping : free_slots)
+		sleeping.clear();
+	num_live = 0;
+}
+
+void SurvivalMode::start(vec2 arena_min, vec2 arena_max)
+{
+	// keep spawns off the walls
+	spawn_min = arena_min + 100.f;
+	spawn_max = arena_max - 100.f;
+	running = true;
+	finished = false;
+	enemies.clear();
+	wave_number = 0;
+	pending_spawns = 0;
+	wave_timer_ms = CLEARED_WAVE_DELAY_MS;
+	smoothed_frame_ms = 0.f;
+	window_worst_ms = 0.f;
+	last_worst_frame_ms = 0.f;
+	window_ms = 0.f;
+	over_budget_ms = 0.f;
+	max_enemies = 0;
+	max_projectiles = 0;
+}
+
+void SurvivalMode::stop()
+{
+	running = false;
+	finished = false;
+	enemies.clear();
+}
+
+float SurvivalMode::budget_ms() const
+{
+	return FRAME_BUDGET_MS;
+}
+
+void SurvivalMode::step(RenderSystem* renderer, float elapsed_ms)
+{
+	if (!is_running()) return;
+
+	wave_timer_ms -= elapsed_ms;
+	if (pending_spawns == 0 && enemies.live_count() == 0)
+		wave_timer_ms = std::min(wave_timer_ms, CLEARED_WAVE_DELAY_MS);
+	if (wave_timer_ms <= 0.f) {
+		wave_number++;
+		// every wave is twice the last one
+		uint wave_size = FIRST_WAVE_ENEMIES;
+		for (uint w = 1; w < wave_number && wave_size < MAX_WAVE_ENEMIES; w++)
+			wave_size *= 2;
+		pending_spawns += std::min(wave_size, MAX_WAVE_ENEMIES);
+		wave_timer_ms = WAVE_INTERVAL_MS;
+		printf("Survival wave %u: %u enemies\n", wave_number, pending_spawns);
+	}
+
+	for (uint s = 0; s < SPAWNS_PER_STEP && pending_spawns > 0 && enemies.live_count() < MAX_LIVE_ENEMIES; s++) {
+		spawnEnemy(renderer);
+		pending_spawns--;
+	}
+
+	max_enemies = std::max(max_enemies, enemies.live_count());
+	max_projectiles = std::max(max_projectiles, projectile_pool.live_count());
+}
+
+// Somewhere along the edge of the arena, away from where the player usually is
+void SurvivalMode::spawnEnemy(RenderSystem* renderer)
+{
+	static const Enemy normal_enemies[] = { WATER_NORMAL, FIRE_NORMAL, EARTH_NORMAL, LIGHTNING_NORMAL };
+
+	Pcg32& gen = rng.stream(RNG_WAVES);
+	Enemy attributes = normal_enemies[gen.below(4)];
+	attributes.isAggravated = true;
+
+	vec2 position;
+	float t = gen.uniform(0.f, 1.f);
+	switch (gen.below(4)) {
+	case 0: position = { spawn_min.x + t * (spawn_max.x - spawn_min.x), spawn_min.y }; break;
+	case 1: position = { spawn_min.x + t * (spawn_max.x - spawn_min.x), spawn_max.y }; break;
+	case 2: position = { spawn_min.x, spawn_min.y + t * (spawn_max.y - spawn_min.y) }; break;
+	default: position = { spawn_max.x, spawn_min.y + t * (spawn_max.y - spawn_min.y) }; break;
+	}
+	enemies.acquire(renderer, position, attributes);
+}
+
+void SurvivalMode::record_frame(float frame_ms)
+{
+	if (!is_running()) return;
+
+	smoothed_frame_ms = (smoothed_frame_ms > 0.f) ? smoothed_frame_ms + FRAME_SMOOTHING * (frame_ms - smoothed_frame_ms) : frame_ms;
+	window_worst_ms = std::max(window_worst_ms, frame_ms);
+	window_ms += frame_ms;
+	if (window_ms >= 1000.f) {
+		last_worst_frame_ms = window_worst_ms;
+		window_worst_ms = 0.f;
+		window_ms = 0.f;
+	}
+
+	// nothing is measured before the first wave, loading the level makes the first frames slow
+	if (wave_number == 0) return;
+	over_budget_ms = (smoothed_frame_ms > FRAME_BUDGET_MS) ? over_budget_ms + frame_ms : 0.f;
+	if (over_budget_ms >= OVER_BUDGET_LIMIT_MS) {
+		finished = true;
+		printf("Survival over frame budget (%.1f ms) at wave %u: %.2f ms average frame, %u enemies, %u projectiles at peak\n",
+			FRAME_BUDGET_MS, wave_number, smoothed_frame_ms, max_enemies, max_projectiles);
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "components.hpp"
+#include "render_system.hpp"
+
+// stlib
+#include <vector>
+
+// Recycles enemies between waves instead of createEnemy/remove_all_components_of. A killed
+// enemy is put to sleep: it loses its Enemy, Collidable and RenderRequest and its health bar
+// loses its HealthBar, and it is parked outside the arena where its shadow is never lit.
+// Sleeping enemies are kept per element type, so a woken one still has the right sprites.
+class EnemyPool
+{
+public:
+	// A sleeping enemy of the same type moved to position, or a new one when there is none
+	Entity acquire(RenderSystem* renderer, vec2 position, const Enemy& attributes);
+	// Puts an enemy to sleep, enemies the pool did not create are removed entirely
+	void release(Entity enemy);
+	// Forget every slot, for when the registry has been cleared
+	void clear();
+
+	uint live_count() const { return num_live; }
+
+private:
+	std::vector<Entity> slot_entities;
+	std::vector<RenderRequest> slot_requests; // taken off while asleep, put back on wake up
+	std::vector<RenderRequest> slot_bar_requests; // same for the enemy's health bar
+	std::vector<uint> free_slots[ElementType::COUNT];
+	uint num_live = 0;
+};
+
+// Horde mode in the boss arena used as a repeatable stress test. Waves of enemies come in on
+// a timer, each one twice the size of the last, and the run ends once frame times stay over
+// budget. Enemies of earlier waves stay around, so the load keeps building up.
+class SurvivalMode
+{
+public:
+	// arena_min/max is the floor enemies may spawn on
+	void start(vec2 arena_min, vec2 arena_max);
+	void stop();
+
+	// Starts waves when they are due and spawns some of the pending enemies
+	void step(RenderSystem* renderer, float elapsed_ms);
+	// Time the last frame took, drives the HUD and the end of the run
+	void record_frame(float frame_ms);
+
+	bool is_running() const { return running && !finished; }
+	bool is_finished() const { return finished; }
+
+	uint wave() const { return wave_number; }
+	uint live_enemies() const { return enemies.live_count(); }
+	uint peak_enemies() const { return max_enemies; }
+	uint peak_projectiles() const { return max_projectiles; }
+	float frame_ms() const { return smoothed_frame_ms; }
+	float worst_frame_ms() const { return last_worst_frame_ms; }
+	float budget_ms() const;
+	float next_wave_ms() const { return wave_timer_ms; }
+
+	EnemyPool enemies;
+
+private:
+	void spawnEnemy(RenderSystem* renderer);
+
+	bool running = false;
+	bool finished = false;
+	vec2 spawn_min = { 0.f, 0.f };
+	vec2 spawn_max = { 0.f, 0.f };
+
+	uint wave_number = 0;
+	uint pending_spawns = 0; // enemies of the current wave not spawned yet
+	float wave_timer_ms = 0.f;
+
+	float smoothed_frame_ms = 0.f;
+	float window_worst_ms = 0.f; // in the second being measured
+	float last_worst_frame_ms = 0.f; // in the last full second
+	float window_ms = 0.f;
+	float over_budget_ms = 0.f;
+	uint max_enemies = 0;
+	uint max_projectiles = 0;
+};
+
+extern SurvivalMode survival;
@@ -0,0 +1,193 @@
+// internal
+#include "texture_atlas.hpp"
+#include "../ext/stb_image/stb_image.h"
+
+// stlib
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+// Bump whenever the cache layout or the packing changes
+const uint32_t ATLAS_CACHE_VERSION = 1;
+const char ATLAS_CACHE_MAGIC[4] = { 'A', 'T', 'L', 'S' };
+
+long long fileStamp(const std::string& path)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) return 0;
+	return (long long)info.st_mtime;
+}
+
+template <typename T>
+void writeValue(std::ofstream& out, const T& value)
+{
+	out.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::ifstream& in, T& value)
+{
+	return (bool)in.read((char*)&value, sizeof(T));
+}
+
+bool TextureAtlas::build(const std::vector<std::string>& sources, const std::string& cache_path)
+{
+	source_paths = sources;
+	source_stamps.resize(sources.size());
+	for (uint i = 0; i < sources.size(); i++)
+		source_stamps[i] = fileStamp(sources[i]);
+
+	loaded_from_cache = load_cache(cache_path);
+	if (loaded_from_cache) return true;
+
+	if (!pack()) return false;
+	save_cache(cache_path);
+	return true;
+}
+
+void TextureAtlas::release_pixels()
+{
+	for (Page& page : atlas_pages)
+		std::vector<unsigned char>().swap(page.pixels);
+}
+
+bool TextureAtlas::pack()
+{
+	regions.assign(source_paths.size(), Region());
+	atlas_pages.clear();
+
+	std::vector<stbi_uc*> images(source_paths.size(), nullptr);
+	for (uint i = 0; i < source_paths.size(); i++) {
+		images[i] = stbi_load(source_paths[i].c_str(), &regions[i].size.x, &regions[i].size.y, NULL, 4);
+		if (images[i] == NULL) {
+			fprintf(stderr, "Could not load the file %s.\n", source_paths[i].c_str());
+			for (stbi_uc* image : images) stbi_image_free(image);
+			return false;
+		}
+	}
+
+	// shelf packing, tallest images first so each shelf wastes little height
+	std::vector<uint> order(source_paths.size());
+	for (uint i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint a, uint b) {
+		return regions[a].size.y > regions[b].size.y;
+	});
+
+	int page = -1;
+	ivec2 cursor = { 0, 0 };
+	int shelf_height = 0;
+	for (uint i : order) {
+		Region& region = regions[i];
+		ivec2 padded = region.size + 2 * ATLAS_PADDING;
+		if (padded.x > ATLAS_PAGE_SIZE || padded.y > ATLAS_PAGE_SIZE) continue;
+
+		if (page >= 0 && cursor.x + padded.x > ATLAS_PAGE_SIZE) {
+			cursor = { 0, cursor.y + shelf_height };
+			shelf_height = 0;
+		}
+		if (page < 0 || cursor.y + padded.y > ATLAS_PAGE_SIZE) {
+			atlas_pages.push_back({ ivec2(0), {} });
+			page++;
+			cursor = { 0, 0 };
+			shelf_height = 0;
+		}
+		region.page = page;
+		region.offset = cursor + ATLAS_PADDING;
+		cursor.x += padded.x;
+		shelf_height = std::max(shelf_height, padded.y);
+		// pages only grow as far as their contents
+		atlas_pages[page].size = max(atlas_pages[page].size, ivec2(cursor.x, cursor.y + shelf_height));
+	}
+
+	for (Page& atlas_page : atlas_pages)
+		atlas_page.pixels.assign(atlas_page.size.x * atlas_page.size.y * 4, 0);
+
+	for (uint i = 0; i < regions.size(); i++) {
+		Region& region = regions[i];
+		if (region.page >= 0) {
+			Page& atlas_page = atlas_pages[region.page];
+			// copy with the border texels repeated into the padding
+			for (int y = -ATLAS_PADDING; y < region.size.y + ATLAS_PADDING; y++) {
+				int src_y = std::min(std::max(y, 0), region.size.y - 1);
+				for (int x = -ATLAS_PADDING; x < region.size.x + ATLAS_PADDING; x++) {
+					int src_x = std::min(std::max(x, 0), region.size.x - 1);
+					const stbi_uc* src = images[i] + (src_y * region.size.x + src_x) * 4;
+					unsigned char* dst = &atlas_page.pixels[((region.offset.y + y) * atlas_page.size.x + region.offset.x + x) * 4];
+					memcpy(dst, src, 4);
+				}
+			}
+			region.uv_rect = vec4(vec2(region.offset) / vec2(atlas_page.size), vec2(region.size) / vec2(atlas_page.size));
+		}
+		stbi_image_free(images[i]);
+	}
+	return true;
+}
+
+bool TextureAtlas::load_cache(const std::string& cache_path)
+{
+	std::ifstream in(cache_path, std::ios::binary);
+	if (!in) return false;
+
+	char magic[4];
+	uint32_t version, num_sources, num_pages;
+	if (!in.read(magic, 4) || memcmp(magic, ATLAS_CACHE_MAGIC, 4) != 0) return false;
+	if (!readValue(in, version) || version != ATLAS_CACHE_VERSION) return false;
+	if (!readValue(in, num_sources) || num_sources != source_paths.size()) return false;
+
+	// any added, removed, renamed or edited image makes the whole cache stale
+	regions.assign(num_sources, Region());
+	for (uint i = 0; i < num_sources; i++) {
+		uint32_t path_length;
+		long long stamp;
+		if (!readValue(in, path_length) || path_length != source_paths[i].size()) return false;
+		std::string path(path_length, '\0');
+		if (!in.read(&path[0], path_length) || path != source_paths[i]) return false;
+		if (!readValue(in, stamp) || stamp != source_stamps[i] || stamp == 0) return false;
+		Region& region = regions[i];
+		if (!readValue(in, region.page) || !readValue(in, region.size) || !readValue(in, region.offset) ||
+			!readValue(in, region.uv_rect))
+			return false;
+	}
+
+	if (!readValue(in, num_pages)) return false;
+	atlas_pages.assign(num_pages, Page());
+	for (Page& atlas_page : atlas_pages) {
+		if (!readValue(in, atlas_page.size)) return false;
+		if (atlas_page.size.x <= 0 || atlas_page.size.y <= 0 ||
+			atlas_page.size.x > ATLAS_PAGE_SIZE || atlas_page.size.y > ATLAS_PAGE_SIZE)
+			return false;
+		atlas_page.pixels.resize(atlas_page.size.x * atlas_page.size.y * 4);
+		if (!in.read((char*)atlas_page.pixels.data(), atlas_page.pixels.size())) return false;
+	}
+	return true;
+}
+
+void TextureAtlas::save_cache(const std::string& cache_path) const
+{
+	std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		// not fatal, the atlas is packed again on the next launch
+		fprintf(stderr, "Could not write the texture atlas cache %s.\n", cache_path.c_str());
+		return;
+	}
+
+	out.write(ATLAS_CACHE_MAGIC, 4);
+	writeValue(out, ATLAS_CACHE_VERSION);
+	writeValue(out, (uint32_t)source_paths.size());
+	for (uint i = 0; i < source_paths.size(); i++) {
+		writeValue(out, (uint32_t)source_paths[i].size());
+		out.write(source_paths[i].data(), source_paths[i].size());
+		writeValue(out, source_stamps[i]);
+		writeValue(out, regions[i].page);
+		writeValue(out, regions[i].size);
+		writeValue(out, regions[i].offset);
+		writeValue(out, regions[i].uv_rect);
+	}
+	writeValue(out, (uint32_t)atlas_pages.size());
+	for (const Page& atlas_page : atlas_pages) {
+		writeValue(out, atlas_page.size);
+		out.write((const char*)atlas_page.pixels.data(), atlas_page.pixels.size());
+	}
+}
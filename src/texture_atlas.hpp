@@ -0,0 +1,57 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <string>
+#include <vector>
+
+// Largest atlas page, GL 3.3 only promises 1024 but every desktop GPU takes far more
+const int ATLAS_PAGE_SIZE = 2048;
+// Texels each image is extruded by on every side so linear filtering never reads a neighbour
+const int ATLAS_PADDING = 2;
+
+// Packs images into a few large pages so sprites using any of them can share one texture.
+// Packing reads every image, so the packed pages are cached in a single file and only
+// repacked when the list of images or the modification time of one of them changes.
+class TextureAtlas
+{
+public:
+	struct Region
+	{
+		int page = -1; // -1 for images too large for a page, those need a texture of their own
+		ivec2 size = { 0, 0 }; // in pixels
+		ivec2 offset = { 0, 0 }; // top left corner within the page in pixels
+		vec4 uv_rect = { 0.f, 0.f, 1.f, 1.f }; // offset and size within the page in texcoords
+	};
+
+	struct Page
+	{
+		ivec2 size;
+		std::vector<unsigned char> pixels; // RGBA, emptied by release_pixels
+	};
+
+	// Fills the atlas from the cache when it matches the sources, otherwise packs the sources
+	// and rewrites the cache. Returns false if a source could not be loaded.
+	bool build(const std::vector<std::string>& sources, const std::string& cache_path);
+
+	// Where source i ended up, in the order given to build
+	const Region& region(uint source) const { return regions[source]; }
+	const std::vector<Page>& pages() const { return atlas_pages; }
+	bool from_cache() const { return loaded_from_cache; }
+
+	// Drop the CPU copy of the pages once they have been uploaded
+	void release_pixels();
+
+private:
+	bool load_cache(const std::string& cache_path);
+	void save_cache(const std::string& cache_path) const;
+	bool pack();
+
+	std::vector<std::string> source_paths;
+	std::vector<long long> source_stamps; // modification times, 0 when the file is missing
+	std::vector<Region> regions;
+	std::vector<Page> atlas_pages;
+	bool loaded_from_cache = false;
+};
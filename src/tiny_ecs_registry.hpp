@@ -29,7 +29,6 @@ public:
 	ComponentContainer<Velocity> velocities;
 	ComponentContainer<Floor> floors;
 	ComponentContainer<Direction> directions;
-	ComponentContainer<Collision> collisions;
 	ComponentContainer<Collidable> collidables;
 	ComponentContainer<Player> players;
 	ComponentContainer<Enemy> enemies;
@@ -73,7 +72,6 @@ public:
 		registry_list.push_back(&velocities);
 		registry_list.push_back(&floors);
 		registry_list.push_back(&directions);
-		registry_list.push_back(&collisions);
 		registry_list.push_back(&collidables);
 		registry_list.push_back(&players);
 		registry_list.push_back(&enemies);
@@ -120,13 +118,6 @@ public:
 		for (ContainerInterface* reg : registry_list)
 			reg->remove(e);
 	}
-
-	void remove_all_components_of_no_collision(Entity e) {
-		for (ContainerInterface* reg : registry_list) {
-			if (reg == &collisions) continue;
-			reg->remove(e);
-		}
-	}
 };
 
 extern ECSRegistry registry;
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "ui_system.hpp"
+#include "survival_mode.hpp"
+#include "projectile_pool.hpp"
 
 UISystem* UISystem::instancePtr = NULL;
 
@@ -15,6 +17,8 @@ void UISystem::showWindows() {
 	if (state == MAIN_MENU) showMainMenu(&show_menu);
 	if (state == PAUSE_MENU) showPauseMenu(&show_menu);
 	if (show_tutorial) showTutorial(&show_tutorial);
+	if (state == PLAY_GAME && survival.is_running()) showSurvivalHud();
+	if (state == PLAY_GAME && debugging.in_debug_mode) showRenderStats();
 }
 
 void UISystem::showMainMenu(bool* p_open) {
@@ -76,6 +80,12 @@ void UISystem::showMainMenu(bool* p_open) {
 		//	//*p_open = false;
 		//}
 
+		ImGui::SetCursorPosX((w - button_size.x) * 0.5f);
+		if (ImGui::Button("Survival Mode", button_size)) {
+			state = NEW_SURVIVAL;
+			*p_open = false;
+		}
+
 		ImGui::SetCursorPosX((w - button_size.x) * 0.5f);
 		if (ImGui::Button("Quit Game", button_size)) {
 			state = QUIT;
@@ -183,6 +193,48 @@ void UISystem::showTutorial(bool* p_open) {
 	ImGui::End();
 }
 
+void UISystem::showSurvivalHud() {
+	static ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings |
+		ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs;
+
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x + 10.f, viewport->Pos.y + 10.f));
+	ImGui::SetNextWindowBgAlpha(0.5f);
+
+	if (ImGui::Begin("Survival", NULL, flags)) {
+		ImGui::Text("Wave %u, next in %.0f s", survival.wave(), survival.next_wave_ms() / 1000.f);
+		ImGui::Text("Enemies %u (peak %u)", survival.live_enemies(), survival.peak_enemies());
+		ImGui::Text("Projectiles %u (peak %u)", projectile_pool.live_count(), survival.peak_projectiles());
+		// red once the average goes over budget, the run ends if it stays there
+		ImVec4 color = (survival.frame_ms() > survival.budget_ms()) ? ImVec4(1.f, 0.3f, 0.3f, 1.f) : ImVec4(1.f, 1.f, 1.f, 1.f);
+		ImGui::TextColored(color, "Frame %.2f ms (worst %.2f) / %.2f ms", survival.frame_ms(), survival.worst_frame_ms(), survival.budget_ms());
+	}
+
+	ImGui::End();
+}
+
+void UISystem::showRenderStats() {
+	static ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings |
+		ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs;
+
+	// top right, out of the way of the survival HUD
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x + viewport->Size.x - 10.f, viewport->Pos.y + 10.f), 0, ImVec2(1.f, 0.f));
+	ImGui::SetNextWindowBgAlpha(0.5f);
+
+	if (ImGui::Begin("Render Stats", NULL, flags)) {
+		ImGui::Text("Draw calls %u", perf_stats.draw_calls);
+		ImGui::Text("Sprites %u in %u batches", perf_stats.batched_sprites, perf_stats.sprite_batches);
+		ImGui::Text("Drawn %u, culled %u", perf_stats.render_drawn, perf_stats.render_culled);
+		// elided changes falling behind issued ones means draws stopped arriving in state order
+		uint state_changes = perf_stats.gl_state_issued + perf_stats.gl_state_elided;
+		ImGui::Text("GL state %u issued, %u elided (%.0f%%)", perf_stats.gl_state_issued, perf_stats.gl_state_elided,
+			state_changes > 0 ? 100.f * perf_stats.gl_state_elided / state_changes : 0.f);
+	}
+
+	ImGui::End();
+}
+
 void UISystem::CenterText(const char* text) {
 	ImVec2 textSize = ImGui::CalcTextSize(text);
 	float w = ImGui::GetWindowWidth();
@@ -14,7 +14,8 @@ enum State {
 	PLAY_GAME = 3,
 	LOAD = 4,
 	SAVE = 5,
-	QUIT = 6
+	QUIT = 6,
+	NEW_SURVIVAL = 7
 };
 
 class UISystem {
@@ -48,6 +49,8 @@ private:
 	void showMainMenu(bool* p_open);
 	void showPauseMenu(bool* p_open);
 	void showTutorial(bool* p_open);
+	void showSurvivalHud();
+	void showRenderStats();
 	void CenterText(const char* text);
 	void WorldCoordinateText(const char* text, float x, float y);
 
@@ -1,6 +1,6 @@
 #include "utils.hpp"
 #include <cmath>
-#include <random>
+#include "rng.hpp"
 
 /*
         HELPER FUNCTIONS TO DO WITH MOVEMENT:
@@ -71,21 +71,16 @@ bool isWeakTo(ElementType t1, ElementType t2) {
         return t2 == ElementType::EARTH;
     case ElementType:: COMBO:
         // get the weakness timer's current weakTo element
-        return t2 == getRandomElementType(); // randomize weakness
+        return t2 == getRandomElementType(RNG_COMBAT); // randomize weakness
     default:
         return false;
     }
 }
 
 // Helper function to get a random element type
-ElementType getRandomElementType() {
+ElementType getRandomElementType(RNG_STREAM stream) {
     static const std::vector<ElementType> elementTypes = { ElementType::WATER, ElementType::FIRE, ElementType::EARTH, ElementType::LIGHTNING };
 
-    // Use C++11 random number generation
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> distribution(0, elementTypes.size() - 1);
-
-    return elementTypes[distribution(gen)];
+    return elementTypes[rng.stream(stream).below((uint)elementTypes.size())];
 }
 
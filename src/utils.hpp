@@ -1,9 +1,10 @@
 #pragma once
 #include "components.hpp"
+#include "rng.hpp"
 
 Velocity computeVelocity(double speed, Direction direction);
 Velocity computeVelocity(double speed, double angle);
 double directionToRadians(DIRECTION direction);
 bool isWeakTo(ElementType t1, ElementType t2);
-ElementType getRandomElementType();
+ElementType getRandomElementType(RNG_STREAM stream);
 
@@ -1,6 +1,7 @@
 #include "world_init.hpp"
 #include "tiny_ecs_registry.hpp"
 #include "render_system.hpp"
+#include "projectile_pool.hpp"
 
 Entity createAria(RenderSystem* renderer, vec2 pos)
 {
@@ -25,6 +26,7 @@ Entity createAria(RenderSystem* renderer, vec2 pos)
 	// set initial component values
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 	position.scale = vec2(63.f, 100.f);
 
 	Velocity& velocity = registry.velocities.emplace(entity);
@@ -136,6 +138,7 @@ Entity createObstacle(RenderSystem* renderer, vec2 pos, vec2 size, vec2 vel) {
 
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 
 	float scale_factor = size.y / sprite_sheet.frame_height;
 	position.scale = vec2(scale_factor * sprite_sheet.frame_width, scale_factor * sprite_sheet.frame_height);
@@ -175,6 +178,7 @@ Entity createLostSoul(RenderSystem* renderer, vec2 pos) {
 
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 
 	Velocity& velocity = registry.velocities.emplace(entity);
 	velocity.velocity = { 0, 0 };
@@ -204,6 +208,7 @@ Entity createEnemy(RenderSystem* renderer, vec2 pos, Enemy enemyAttributes)
 
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 
 	Velocity& velocity = registry.velocities.emplace(entity);
 	velocity.velocity.x = 50;
@@ -286,6 +291,7 @@ Entity createBoss(RenderSystem* renderer, vec2 pos, Enemy enemyAttributes)
 
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 
 	position.scale = vec2({ 230, 200 });
 
@@ -417,7 +423,8 @@ Entity createFinalBossAura(RenderSystem* renderer, Entity& owner_entity, float x
 		entity,
 		{ TEXTURE_ASSET_ID::FINAL_BOSS_AURA,
 		 EFFECT_ASSET_ID::ANIMATED,
-		 GEOMETRY_BUFFER_ID::FINAL_BOSS_AURA });
+		 GEOMETRY_BUFFER_ID::FINAL_BOSS_AURA,
+		 -1 }); // behind the boss
 
 	return entity;
 }
@@ -712,6 +719,7 @@ Entity createTestSalmon(RenderSystem* renderer, vec2 pos)
 	// set initial component values
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 	position.scale = mesh.original_size * 150.f;
 	position.scale.x *= -1; // point front to the right; with sprites this wont be a thing?
 	// TODO: how to we integrate direction into our entities?
@@ -737,9 +745,11 @@ Entity createTestSalmon(RenderSystem* renderer, vec2 pos)
 }
 
 Entity createProjectile(RenderSystem* renderer, vec2 pos, vec2 vel, ElementType elementType, bool hostile, Entity& player) {
-	auto entity = Entity();
+	Entity entity = projectile_pool.acquire(PROJECTILE_LIFETIME_MS);
+	// a recycled projectile still has its Position, mesh and sprite sheet
+	bool recycled = registry.positions.has(entity);
 
-	Projectile& projectile = registry.projectiles.emplace(entity);
+	Projectile& projectile = registry.projectiles.get(entity);
 	projectile.type = elementType;
 	projectile.hostile = hostile;
 
@@ -776,10 +786,16 @@ Entity createProjectile(RenderSystem* renderer, vec2 pos, vec2 vel, ElementType
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(geometryBuffer);
-	registry.meshPtrs.emplace(entity, &mesh);
-
 	SpriteSheet& sprite_sheet = renderer->getSpriteSheet(spriteSheet);
-	registry.spriteSheetPtrs.emplace(entity, &sprite_sheet);
+	if (recycled) {
+		registry.meshPtrs.get(entity) = &mesh;
+		registry.spriteSheetPtrs.get(entity) = &sprite_sheet;
+	}
+	else {
+		registry.meshPtrs.emplace(entity, &mesh);
+		registry.spriteSheetPtrs.emplace(entity, &sprite_sheet);
+		registry.positions.emplace(entity);
+	}
 
 	Animation& animation = registry.animations.emplace(entity);
 	animation.sprite_sheet_ptr = &sprite_sheet;
@@ -789,8 +805,10 @@ Entity createProjectile(RenderSystem* renderer, vec2 pos, vec2 vel, ElementType
 	velocity.velocity = vel;
 
 	// Set initial position and velocity for the projectile
-	Position& position = registry.positions.emplace(entity);
+	Position& position = registry.positions.get(entity);
+	position = Position();
 	position.position = pos;
+	position.prev_position = pos;
 	position.angle = atan2(vel.y, vel.x);
 	position.scale = vec2(sprite_sheet.frame_width, sprite_sheet.frame_height);
 
@@ -862,6 +880,7 @@ Entity createLifeOrb(RenderSystem* renderer, vec2 pos, int piece_number) {
 
 	Position& position = registry.positions.emplace(entity);
 	position.position = pos;
+	position.prev_position = pos;
 	
 	Velocity& velocity = registry.velocities.emplace(entity);
 	velocity.velocity = { 0.f,0.f };
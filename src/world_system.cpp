@@ -10,12 +10,20 @@
 
 #include "physics_system.hpp"
 #include "ui_system.hpp"
+#include "danger_map.hpp"
+#include "flow_field.hpp"
+#include "projectile_volleys.hpp"
+#include "projectile_pool.hpp"
+#include "survival_mode.hpp"
 using namespace std;
 
 // Game configuration
 float PLAYER_SPEED = 300.f;
 const float PROJECTILE_SPEED = 700.f;
 const int VOLUME = 30;
+// The world used to be stepped twice per frame, its timers (invulnerability, death, win, weakness and
+// mana regen) keep running at that pace now that it is stepped once per tick
+const float WORLD_TIMER_RATE = 2.f;
 
 const string FASTER_MOVEMENT_STRING = "Faster Movement Speed";
 const string TRIPLE_STRING = "Triple";
@@ -24,8 +32,6 @@ const string INCREASE_STRING = "Increase";
 
 // Create the world
 WorldSystem::WorldSystem() {
-	// Seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
 }
 
 WorldSystem::~WorldSystem() {
@@ -280,11 +286,32 @@ void animateLostSoul(Entity& lost_soul) {
 	}
 }
 
-// Update our game world
-bool WorldSystem::step(float elapsed_ms_since_last_update) {
+// Shows the performance counters in the window title, once per rendered frame
+void WorldSystem::update_title() {
 	std::stringstream title_ss;
 	title_ss << "Aria: Whispers of Darkness";
+	if (debugging.in_debug_mode) {
+		ivec2 danger_size = danger_map.size();
+		title_ss << " | danger map " << danger_size.x << "x" << danger_size.y << " @ " << danger_map.cell() << "px: " << danger_map.build_ms() << " ms";
+		title_ss << " | AI " << perf_stats.ai_used_ms << " ms, " << perf_stats.ai_updated << "/" << perf_stats.ai_budget << " decided, "
+			<< perf_stats.ai_deferred << " deferred";
+		title_ss << " | " << perf_stats.draw_calls << " draw calls, " << perf_stats.batched_sprites << " sprites in "
+			<< perf_stats.sprite_batches << " batches, " << perf_stats.render_drawn << " drawn, "
+			<< perf_stats.render_culled << " culled";
+	}
 	glfwSetWindowTitle(window, title_ss.str().c_str());
+}
+
+// Update our game world
+bool WorldSystem::step(float elapsed_ms_since_last_update) {
+	const float timer_elapsed_ms = elapsed_ms_since_last_update * WORLD_TIMER_RATE;
+
+	// survival waves, back to the menu once the run went over its frame budget
+	survival.step(renderer, elapsed_ms_since_last_update);
+	if (survival.is_finished()) {
+		UISystem::getInstance()->setState(MAIN_MENU);
+		return true;
+	}
 
 	// Remove debug info from the last step
 	while (registry.debugComponents.entities.size() > 0)
@@ -302,7 +329,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 
 	for (Entity entity : registry.invulnerableTimers.entities) {
 		InvulnerableTimer& timer = registry.invulnerableTimers.get(entity);
-		timer.timer_ms -= elapsed_ms_since_last_update;
+		timer.timer_ms -= timer_elapsed_ms;
 		if (timer.timer_ms <= 0) {
 			registry.invulnerableTimers.remove(entity);
 		}
@@ -311,14 +338,14 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	Resources& player_resource = registry.resources.get(player);
 	if (player_resource.currentMana < 10.f) {
 		// replenish mana
-		player_resource.currentMana += elapsed_ms_since_last_update / 1000;
+		player_resource.currentMana += timer_elapsed_ms / 1000;
 		if (player_resource.currentMana > 10.f) player_resource.currentMana = 10.f;
 	}
 
     float min_death_timer_ms = 2700.f;
 	for (Entity entity : registry.deathTimers.entities) {
 		DeathTimer& timer = registry.deathTimers.get(entity);
-		timer.timer_ms -= elapsed_ms_since_last_update;
+		timer.timer_ms -= timer_elapsed_ms;
 		if (timer.timer_ms < min_death_timer_ms) {
 			min_death_timer_ms = timer.timer_ms;
 		}
@@ -336,7 +363,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	for (Entity entity : registry.winTimers.entities) {
 		WinTimer& timer = registry.winTimers.get(entity);
 		timer.timer_ms = std::min(timer.timer_ms, min_win_timer_ms);
-		timer.timer_ms -= elapsed_ms_since_last_update;
+		timer.timer_ms -= timer_elapsed_ms;
 		if (timer.timer_ms > 0.f) {
 			screen.apply_spotlight = true;
 			screen.spotlight_radius = timer.timer_ms / min_win_timer_ms;
@@ -372,13 +399,13 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 
 	for (Entity entity : registry.weaknessTimers.entities) {
 		WeaknessTimer& timer = registry.weaknessTimers.get(entity);
-		timer.timer_ms -= elapsed_ms_since_last_update;
+		timer.timer_ms -= timer_elapsed_ms;
 		if (timer.timer_ms <= 0.f) {
 			// Weakness to this element has expired
 			float max_timer = 12000.f;
-			float curr_timer = max_timer * uniform_dist(rng);
+			float curr_timer = max_timer * rng.stream(RNG_WEAKNESS).uniform(0.7f, 1.f);
 
-			ElementType elementType = getRandomElementType();
+			ElementType elementType = getRandomElementType(RNG_WEAKNESS);
 
 			timer.timer_ms = curr_timer;
 			timer.weakTo = elementType;
@@ -589,8 +616,10 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	}
 
 
-	if (registry.lifeOrbs.entities.size() > 0) {
+	// the player only casts a shadow once a life orb is around to light them
+	if (registry.lifeOrbs.entities.size() > 0 && !player_has_shadow) {
 		createShadow(renderer, player, TEXTURE_ASSET_ID::PLAYER, GEOMETRY_BUFFER_ID::PLAYER);
+		player_has_shadow = true;
 	}
 	return true;
 }
@@ -622,6 +651,10 @@ void WorldSystem::restart_game() {
 		registry.remove_all_components_of(registry.resources.entities.back());
 	while (registry.collidables.entities.size() > 0)
 		registry.remove_all_components_of(registry.collidables.entities.back());
+	contacts.clear();
+	volleys.clear();
+	projectile_pool.clear();
+	survival.stop();
 
 	GameLevel current_level = this->curr_level;
 	vec2 player_starting_pos = current_level.getPlayerStartingPos();
@@ -684,6 +717,7 @@ void WorldSystem::restart_game() {
 
 
 	player = createAria(renderer, player_starting_pos);
+	player_has_shadow = false;
 	if (this->curr_level.getIsCutscene()) {
 		Cutscene& cutscene = registry.cutscenes.emplace(player);
 		if (this->curr_level.curr_level == CUTSCENE_6) cutscene.is_cutscene_6 = true;
@@ -694,6 +728,13 @@ void WorldSystem::restart_game() {
 		// Familarize player with health pack
 		registry.resources.get(player).currentHealth = 20.f;
 	}
+	else if (curr_level == Level::SURVIVAL) {
+		// the run should end on frame time, not because the player died
+		Resources& player_resources = registry.resources.get(player);
+		player_resources.maxHealth = player_resources.currentHealth = 10000.f;
+		player_resources.maxMana = player_resources.currentMana = 10000.f;
+		survival.start(vec2(floors[0].x, floors[0].y), vec2(floors[0].x + floors[0].z, floors[0].y + floors[0].w));
+	}
 
 	// ADD BACK THE PERSISTED COMPONENTS
 	if (persistPowerUps) registry.powerUps.get(player) = persistedPowerUps;
@@ -710,6 +751,8 @@ void WorldSystem::restart_game() {
 			terrain_attr.speed,
 			terrain_attr.moveable);
 	}
+	flow_field.bake(terrains_attrs);
+	projectile_pool.set_bounds(terrains_attrs);
 
 	for (uint i = 0; i < health_packs_pos.size(); i++) {
 		vec2 pos = health_packs_pos[i];
@@ -872,6 +915,12 @@ void WorldSystem::new_game() {
 	restart_game();
 }
 
+void WorldSystem::new_survival() {
+	if (registry.players.has(player)) registry.remove_all_components_of(player);
+	curr_level.init(SURVIVAL);
+	restart_game();
+}
+
 void WorldSystem::display_power_up() {
 	PowerUp& powerUp = registry.powerUps.get(player);
 
@@ -897,7 +946,7 @@ void WorldSystem::display_power_up() {
 		return;
 	}
 
-	shuffle(availPowerUps.begin(), availPowerUps.end(), rng);
+	shuffle(availPowerUps.begin(), availPowerUps.end(), rng.stream(RNG_POWER_UPS));
 	/*for (int i = 0; i < availPowerUps.size(); i++) {
 		printf("%s\n", availPowerUps[i].first.c_str());
 	}*/
@@ -937,379 +986,399 @@ POWER_UP_BLOCK_STATES getPowerUpBlockStateFromString(string powerUpText) {
 // Compute collisions between entities
 void WorldSystem::handle_collisions() {
 	if (registry.deathTimers.has(player) || registry.winTimers.has(player)) { return; } 
-	// Loop over all collisions detected by the physics system
-	auto& collisionsRegistry = registry.collisions;
-	for (uint i = 0; i < collisionsRegistry.components.size(); i++) {
-		// The entity and its collider
-		Entity entity = collisionsRegistry.entities[i];
-		Entity entity_other = collisionsRegistry.components[i].other_entity;
-
-		// Checking Player - Enemy collisions
-		if (registry.enemies.has(entity_other) && registry.players.has(entity)) {
-			Enemy& enemy = registry.enemies.get(entity_other);
-			if (!enemy.isAggravated) {
-				enemy.isAggravated = true;
-
-				if (registry.bosses.has(entity_other)) {
-					uint curr_level = this->curr_level.getCurrLevel();
+	// Loop over all contact transitions detected by the physics system
+	for (const ContactEvent& event : contacts.events()) {
+		// Each pair is stored once, so run the checks from the point of view of both entities
+		Contact contact = event.contact;
+		if (!handle_contact(event.phase, contact.entity_a, contact.entity_b, contact.displacement, contact.normal)) return;
+		if (!handle_contact(event.phase, contact.entity_b, contact.entity_a, -contact.displacement, -contact.normal)) return;
+	}
+
+	// update position of entities that follow player or enemies to remove jitter
+	for (int i = 0; i < registry.followers.size(); i++) {
+		Follower& follower = registry.followers.components[i];
+		Entity entity = registry.followers.entities[i];
+		Position& position = registry.positions.get(entity);
+		Position& owner_position = registry.positions.get(follower.owner);
+		position.position = owner_position.position;
+		position.position.y += follower.y_offset;
+		position.position.x += follower.x_offset;
+	}
+
+	// 2nd phase of position correction strictly after first phase
+	for (int i = 0; i < registry.secondaryFollowers.size(); i++) {
+		SecondaryFollower& follower = registry.secondaryFollowers.components[i];
+		Entity entity = registry.secondaryFollowers.entities[i];
+		Position& position = registry.positions.get(entity);
+		Position& owner_position = registry.positions.get(follower.owner);
+		position.position = owner_position.position;
+		position.position.y += follower.y_offset;
+		position.position.x += follower.x_offset;
+	}
+}
 
-					if (curr_level == Level::FIRE_BOSS ||
-						curr_level == Level::EARTH_BOSS ||
-						curr_level == Level::LIGHTNING_BOSS ||
-						curr_level == Level::WATER_BOSS) {
-						Mix_FadeInMusic(boss_music, -1, 250);
-					}
-					else if (curr_level == Level::FINAL_BOSS) {
-						Mix_FadeInMusic(final_boss_music, -1, 250);
-					}
+// Reacts to one contact transition between entity and entity_other, returns false if
+// the level ended and the remaining contacts should not be handled
+bool WorldSystem::handle_contact(CONTACT_PHASE phase, Entity entity, Entity entity_other, vec2 displacement, vec2 normal) {
+	// one-shot reactions (damage, pickups, doors) only run when a pair starts touching,
+	// physical responses keep running for as long as the pair touches
+	bool began = phase == CONTACT_PHASE::BEGIN;
+	bool touching = phase != CONTACT_PHASE::END;
+
+	// Checking Player - Enemy collisions
+	if (touching && registry.enemies.has(entity_other) && registry.players.has(entity)) {
+		Enemy& enemy = registry.enemies.get(entity_other);
+		if (!enemy.isAggravated) {
+			enemy.isAggravated = true;
+
+			if (registry.bosses.has(entity_other)) {
+				uint curr_level = this->curr_level.getCurrLevel();
+
+				if (curr_level == Level::FIRE_BOSS ||
+					curr_level == Level::EARTH_BOSS ||
+					curr_level == Level::LIGHTNING_BOSS ||
+					curr_level == Level::WATER_BOSS) {
+					Mix_FadeInMusic(boss_music, -1, 250);
 				}
-			}
-
-			if (!registry.invulnerableTimers.has(entity)) {
-				Mix_PlayChannel(-1, damage_tick_sound, 0);
-				Resources& player_resource = registry.resources.get(entity);
-				player_resource.currentHealth -= registry.enemies.get(entity_other).damage;
-				printf("player hp: %f\n", player_resource.currentHealth);
-				registry.invulnerableTimers.emplace(entity);
-				if (player_resource.currentHealth <= 0) {
-					registry.deathTimers.emplace(entity);
-					registry.velocities.get(player).velocity = { 0.f, 0.f };
-					Mix_PlayChannel(-1, aria_death_sound, 0);
-					if (this->curr_level.getCurrLevel() != FINAL_BOSS && !this->curr_level.getIsBossLevel()) Mix_PlayChannel(-1, aria_death_lsvl, 0);
+				else if (curr_level == Level::FINAL_BOSS) {
+					Mix_FadeInMusic(final_boss_music, -1, 250);
 				}
 			}
 		}
-		//Checking Player - Obstacle collision
-		if (registry.players.has(entity) && registry.obstacles.has(entity_other)) {
-			if (!registry.invulnerableTimers.has(entity)) {
-				Mix_PlayChannel(-1, obstacle_collision_sound, 0);
-				registry.invulnerableTimers.emplace(entity);
+
+		if (!registry.invulnerableTimers.has(entity)) {
+			Mix_PlayChannel(-1, damage_tick_sound, 0);
+			Resources& player_resource = registry.resources.get(entity);
+			player_resource.currentHealth -= registry.enemies.get(entity_other).damage;
+			printf("player hp: %f\n", player_resource.currentHealth);
+			registry.invulnerableTimers.emplace(entity);
+			if (player_resource.currentHealth <= 0) {
 				registry.deathTimers.emplace(entity);
 				registry.velocities.get(player).velocity = { 0.f, 0.f };
-				// ADD ARIA DEATH SOUND
 				Mix_PlayChannel(-1, aria_death_sound, 0);
 				if (this->curr_level.getCurrLevel() != FINAL_BOSS && !this->curr_level.getIsBossLevel()) Mix_PlayChannel(-1, aria_death_lsvl, 0);
 			}
 		}
+	}
+	//Checking Player - Obstacle collision
+	if (touching && registry.players.has(entity) && registry.obstacles.has(entity_other)) {
+		if (!registry.invulnerableTimers.has(entity)) {
+			Mix_PlayChannel(-1, obstacle_collision_sound, 0);
+			registry.invulnerableTimers.emplace(entity);
+			registry.deathTimers.emplace(entity);
+			registry.velocities.get(player).velocity = { 0.f, 0.f };
+			// ADD ARIA DEATH SOUND
+			Mix_PlayChannel(-1, aria_death_sound, 0);
+			if (this->curr_level.getCurrLevel() != FINAL_BOSS && !this->curr_level.getIsBossLevel()) Mix_PlayChannel(-1, aria_death_lsvl, 0);
+		}
+	}
 
-		// Checking obstacle - obstacle collisions
-		if (registry.obstacles.has(entity) && registry.obstacles.has(entity_other)) {
-			Position& pos_1 = registry.positions.get(entity);
-			Position& pos_2 = registry.positions.get(entity_other);
-			Velocity& vel_1 = registry.velocities.get(entity);
-			Velocity& vel_2 = registry.velocities.get(entity_other);
-
-			vec2 delt_v = vel_2.velocity - vel_1.velocity;
-			vec2 delt_p = pos_2.position - pos_1.position;
-
-			if (dot(delt_v, delt_p) <= 0) {
-				vec2 pi = pos_1.position;
-				vec2 pj = pos_2.position;
-				vec2 vi = vel_1.velocity;
-				vec2 vj = vel_2.velocity;
-				vec2 new_vi = vi - dot(vi - vj, pi - pj) / dot(pi - pj, pi - pj) * (pi - pj);
-				vec2 new_vj = vj - dot(vj - vi, pj - pi) / dot(pj - pi, pj - pi) * (pj - pi);
-
-				vel_1.velocity.x = new_vi.x;
-				vel_1.velocity.y = new_vi.y;
-				vel_2.velocity.x = new_vj.x;
-				vel_2.velocity.y = new_vj.y;
-			};
+	// Checking obstacle - obstacle collisions
+	if (touching && registry.obstacles.has(entity) && registry.obstacles.has(entity_other)) {
+		Position& pos_1 = registry.positions.get(entity);
+		Position& pos_2 = registry.positions.get(entity_other);
+		Velocity& vel_1 = registry.velocities.get(entity);
+		Velocity& vel_2 = registry.velocities.get(entity_other);
+
+		vec2 delt_v = vel_2.velocity - vel_1.velocity;
+		vec2 delt_p = pos_2.position - pos_1.position;
+
+		if (dot(delt_v, delt_p) <= 0) {
+			vec2 pi = pos_1.position;
+			vec2 pj = pos_2.position;
+			vec2 vi = vel_1.velocity;
+			vec2 vj = vel_2.velocity;
+			vec2 new_vi = vi - dot(vi - vj, pi - pj) / dot(pi - pj, pi - pj) * (pi - pj);
+			vec2 new_vj = vj - dot(vj - vi, pj - pi) / dot(pj - pi, pj - pi) * (pj - pi);
+
+			vel_1.velocity.x = new_vi.x;
+			vel_1.velocity.y = new_vi.y;
+			vel_2.velocity.x = new_vj.x;
+			vel_2.velocity.y = new_vj.y;
+		};
+	}
+
+	// Checking Player - Terrain Collisions
+	if (touching && registry.players.has(entity) && registry.terrain.has(entity_other)) {
+		Position& player_position = registry.positions.get(entity);
+		Position& terrain_position = registry.positions.get(entity_other);
+
+		bool resolved = collision_displace(player_position, terrain_position);
+		if (!resolved) {
+			player_position.position += displacement;
+		}
+	}
+	
+	
+	// Checking Enemy - Terrain Collisions
+	if (touching && registry.enemies.has(entity) && registry.terrain.has(entity_other)) {
+		Position& enemy_position = registry.positions.get(entity);
+		Position& terrain_position = registry.positions.get(entity_other);
+
+		bool resolved = collision_displace(enemy_position, terrain_position);
+		if (!resolved) {
+			enemy_position.position += displacement;
 		}
+	}
 
-		// Checking Player - Terrain Collisions
-		if (registry.players.has(entity) && registry.terrain.has(entity_other)) {
-			Position& player_position = registry.positions.get(entity);
-			Position& terrain_position = registry.positions.get(entity_other);
+	// Checking Moveable Terrain - Terrain Collisions
+	if (touching && registry.terrain.has(entity) && registry.terrain.has(entity_other)) {
+		Terrain& terrain_1 = registry.terrain.get(entity);
+		// Checking if the the terrain is moveable
+		if (terrain_1.moveable) {
+			Velocity& terrain_1_velocity = registry.velocities.get(entity);
+			Position& terrain_1_position = registry.positions.get(entity);
+			Position& terrain_2_position = registry.positions.get(entity_other);
 
-			bool resolved = collision_displace(player_position, terrain_position);
-			if (!resolved) {
-				player_position.position += collisionsRegistry.components[i].displacement;
+			if (collidedLeft(terrain_1_position, terrain_2_position) || collidedRight(terrain_1_position, terrain_2_position)) {
+				terrain_1_velocity.velocity[0] = -terrain_1_velocity.velocity[0]; // switch x direction
+			}
+			if (collidedTop(terrain_1_position, terrain_2_position) || collidedBottom(terrain_1_position, terrain_2_position)) {
+				terrain_1_velocity.velocity[1] = -terrain_1_velocity.velocity[1]; // switch y direction
 			}
 		}
+	}
+	//Checking Obstacle Terrain collisions
+	if (touching && registry.obstacles.has(entity) && registry.terrain.has(entity_other)) {
+			Obstacle& obstacle = registry.obstacles.get(entity);
 		
-		
-		// Checking Enemy - Terrain Collisions
-		if (registry.enemies.has(entity) && registry.terrain.has(entity_other)) {
-			Position& enemy_position = registry.positions.get(entity);
+			Velocity& obstacle_velocity = registry.velocities.get(entity);
+			Position& obstacle_position = registry.positions.get(entity);
 			Position& terrain_position = registry.positions.get(entity_other);
 
-			bool resolved = collision_displace(enemy_position, terrain_position);
-			if (!resolved) {
-				enemy_position.position += collisionsRegistry.components[i].displacement;
+			if (collidedLeft(obstacle_position, terrain_position) || collidedRight(obstacle_position, terrain_position)) {
+				obstacle_velocity.velocity[0] = -obstacle_velocity.velocity[0]; // switch x direction
 			}
-		}
-
-		// update position of entities that follow player or enemies to remove jitter
-		for (int i = 0; i < registry.followers.size(); i++) {
-			Follower& follower = registry.followers.components[i];
-			Entity entity = registry.followers.entities[i];
-			Position& position = registry.positions.get(entity);
-			Position& owner_position = registry.positions.get(follower.owner);
-			position.position = owner_position.position;
-			position.position.y += follower.y_offset;
-			position.position.x += follower.x_offset;
-		}
-
-		// 2nd phase of position correction strictly after first phase
-		for (int i = 0; i < registry.secondaryFollowers.size(); i++) {
-			SecondaryFollower& follower = registry.secondaryFollowers.components[i];
-			Entity entity = registry.secondaryFollowers.entities[i];
-			Position& position = registry.positions.get(entity);
-			Position& owner_position = registry.positions.get(follower.owner);
-			position.position = owner_position.position;
-			position.position.y += follower.y_offset;
-			position.position.x += follower.x_offset;
-		}
+			if (collidedTop(obstacle_position, terrain_position) || collidedBottom(obstacle_position, terrain_position)) {
+				obstacle_velocity.velocity[1] = -obstacle_velocity.velocity[1]; // switch y direction
+			}
+	}
+	// Checking Projectile - Enemy collisions
+	if (began && registry.enemies.has(entity_other) && registry.projectiles.has(entity)) {
+		if (registry.projectiles.get(entity).hostile && registry.projectiles.get(entity).type != registry.enemies.get(entity_other).type && !registry.bosses.has(entity_other)) {
+			// HEAL the target instead
+			registry.resources.get(entity_other).currentHealth += 5;
+			projectile_pool.release(entity); // delete projectile
+			if (registry.resources.get(entity_other).currentHealth > registry.resources.get(entity_other).maxHealth) {
+				registry.resources.get(entity_other).currentHealth = registry.resources.get(entity_other).maxHealth;
+			}
+		} else if (!registry.projectiles.get(entity).hostile) {
+			Enemy& enemy = registry.enemies.get(entity_other);
+			// start boss intro music once aggravated
+			if (!enemy.isAggravated && registry.bosses.has(entity_other)) {
+				enemy.isAggravated = true;
+				uint curr_level = this->curr_level.getCurrLevel();
 
-		// Checking Moveable Terrain - Terrain Collisions
-		if (registry.terrain.has(entity) && registry.terrain.has(entity_other)) {
-			Terrain& terrain_1 = registry.terrain.get(entity);
-			// Checking if the the terrain is moveable
-			if (terrain_1.moveable) {
-				Velocity& terrain_1_velocity = registry.velocities.get(entity);
-				Position& terrain_1_position = registry.positions.get(entity);
-				Position& terrain_2_position = registry.positions.get(entity_other);
-
-				if (collidedLeft(terrain_1_position, terrain_2_position) || collidedRight(terrain_1_position, terrain_2_position)) {
-					terrain_1_velocity.velocity[0] = -terrain_1_velocity.velocity[0]; // switch x direction
+				if (curr_level == Level::FIRE_BOSS ||
+					curr_level == Level::EARTH_BOSS ||
+					curr_level == Level::LIGHTNING_BOSS ||
+					curr_level == Level::WATER_BOSS) {
+					Mix_FadeInMusic(boss_music, -1, 250);
 				}
-				if (collidedTop(terrain_1_position, terrain_2_position) || collidedBottom(terrain_1_position, terrain_2_position)) {
-					terrain_1_velocity.velocity[1] = -terrain_1_velocity.velocity[1]; // switch y direction
+				else if (curr_level == Level::FINAL_BOSS) {
+					Mix_FadeInMusic(final_boss_music, -1, 250);
 				}
 			}
-		}
-		//Checking Obstacle Terrain collisions
-		if (registry.obstacles.has(entity) && registry.terrain.has(entity_other)) {
-				Obstacle& obstacle = registry.obstacles.get(entity);
-			
-				Velocity& obstacle_velocity = registry.velocities.get(entity);
-				Position& obstacle_position = registry.positions.get(entity);
-				Position& terrain_position = registry.positions.get(entity_other);
-
-				if (collidedLeft(obstacle_position, terrain_position) || collidedRight(obstacle_position, terrain_position)) {
-					obstacle_velocity.velocity[0] = -obstacle_velocity.velocity[0]; // switch x direction
-				}
-				if (collidedTop(obstacle_position, terrain_position) || collidedBottom(obstacle_position, terrain_position)) {
-					obstacle_velocity.velocity[1] = -obstacle_velocity.velocity[1]; // switch y direction
+			Mix_PlayChannel(-1, damage_tick_sound, 0);
+			Resources& enemy_resource = registry.resources.get(entity_other);
+			float damage_dealt = registry.projectiles.get(entity).damage; // any damage modifications should be performed on this value
+			if (registry.enemies.get(entity_other).type == registry.projectiles.get(entity).type) {
+				enemy_resource.currentHealth = std::min(enemy_resource.maxHealth, enemy_resource.currentHealth + damage_dealt / 2);
+			}
+			else {
+				ElementType projectile_type = registry.projectiles.get(entity).type;
+				ElementType enemy_type = registry.enemies.get(entity_other).type;
+				if (enemy_type == ElementType::COMBO) {
+					enemy_type = registry.weaknessTimers.get(entity_other).weakTo;
 				}
-		}
-		// Checking Projectile - Enemy collisions
-		if (registry.enemies.has(entity_other) && registry.projectiles.has(entity)) {
-			if (registry.projectiles.get(entity).hostile && registry.projectiles.get(entity).type != registry.enemies.get(entity_other).type && !registry.bosses.has(entity_other)) {
-				// HEAL the target instead
-				registry.resources.get(entity_other).currentHealth += 5;
-				registry.remove_all_components_of_no_collision(entity); // delete projectile
-				if (registry.resources.get(entity_other).currentHealth > registry.resources.get(entity_other).maxHealth) {
-					registry.resources.get(entity_other).currentHealth = registry.resources.get(entity_other).maxHealth;
+
+				if (isWeakTo(enemy_type, projectile_type)) {
+					damage_dealt *= 3;
 				}
-			} else if (!registry.projectiles.get(entity).hostile) {
-				Enemy& enemy = registry.enemies.get(entity_other);
-				// start boss intro music once aggravated
-				if (!enemy.isAggravated && registry.bosses.has(entity_other)) {
-					enemy.isAggravated = true;
-					uint curr_level = this->curr_level.getCurrLevel();
-
-					if (curr_level == Level::FIRE_BOSS ||
-						curr_level == Level::EARTH_BOSS ||
-						curr_level == Level::LIGHTNING_BOSS ||
-						curr_level == Level::WATER_BOSS) {
-						Mix_FadeInMusic(boss_music, -1, 250);
-					}
-					else if (curr_level == Level::FINAL_BOSS) {
-						Mix_FadeInMusic(final_boss_music, -1, 250);
+				enemy_resource.currentHealth -= damage_dealt;
+			}
+	
+			projectile_pool.release(entity); // delete projectile
+
+			printf("enemy hp: %f\n", enemy_resource.currentHealth);
+
+			// remove enemy if health <= 0
+			if (enemy_resource.currentHealth <= 0) {
+				bool is_boss = registry.bosses.has(entity_other); // store bool before removing all components
+				vec2 boss_position;
+				if (is_boss) {
+					boss_position = registry.positions.get(entity_other).position; // store in case boss died so we can spawn life orb
+					Boss& boss = registry.bosses.get(entity_other);
+					if (registry.animations.has(boss.aura)) {
+						registry.remove_all_components_of(boss.aura);
 					}
 				}
-				Mix_PlayChannel(-1, damage_tick_sound, 0);
-				Resources& enemy_resource = registry.resources.get(entity_other);
-				float damage_dealt = registry.projectiles.get(entity).damage; // any damage modifications should be performed on this value
-				if (registry.enemies.get(entity_other).type == registry.projectiles.get(entity).type) {
-					enemy_resource.currentHealth = std::min(enemy_resource.maxHealth, enemy_resource.currentHealth + damage_dealt / 2);
+
+				if (this->curr_level.getCurrLevel() == SURVIVAL) {
+					survival.enemies.release(entity_other);
 				}
 				else {
-					ElementType projectile_type = registry.projectiles.get(entity).type;
-					ElementType enemy_type = registry.enemies.get(entity_other).type;
-					if (enemy_type == ElementType::COMBO) {
-						enemy_type = registry.weaknessTimers.get(entity_other).weakTo;
-					}
-
-					if (isWeakTo(enemy_type, projectile_type)) {
-						damage_dealt *= 3;
-					}
-					enemy_resource.currentHealth -= damage_dealt;
+					registry.remove_all_components_of(enemy_resource.healthBar);
+					registry.remove_all_components_of(entity_other);
 				}
-		
-				registry.remove_all_components_of_no_collision(entity); // delete projectile
-
-				printf("enemy hp: %f\n", enemy_resource.currentHealth);
-
-				// remove enemy if health <= 0
-				if (enemy_resource.currentHealth <= 0) {
-					bool is_boss = registry.bosses.has(entity_other); // store bool before removing all components
-					vec2 boss_position;
-					if (is_boss) {
-						boss_position = registry.positions.get(entity_other).position; // store in case boss died so we can spawn life orb
-						Boss& boss = registry.bosses.get(entity_other);
-						if (registry.animations.has(boss.aura)) {
-							registry.remove_all_components_of(boss.aura);
-						}
+				Mix_PlayChannel(-1, enemy_death_sound, 0);
+
+				// drop a life orb shard and change background music if boss died
+				if (is_boss) {
+					Mix_FadeInMusic(background_music, -1, 1500);
+					registry.weaknessTimers.clear();
+					// fire boss does not drop a shard, so win level and return
+					if (this->curr_level.getCurrLevel() == FIRE_BOSS) {
+						win_level();
+						return false;
 					}
 
-					registry.remove_all_components_of(enemy_resource.healthBar);
-					registry.remove_all_components_of_no_collision(entity_other);
-					Mix_PlayChannel(-1, enemy_death_sound, 0);
-
-					// drop a life orb shard and change background music if boss died
-					if (is_boss) {
-						Mix_FadeInMusic(background_music, -1, 1500);
-						registry.weaknessTimers.clear();
-						// fire boss does not drop a shard, so win level and return
-						if (this->curr_level.getCurrLevel() == FIRE_BOSS) {
-							win_level();
-							return;
-						}
-
-						if (this->curr_level.getCurrLevel() == FINAL_BOSS) {
-							Mix_PlayChannel(-1, final_boss_death_sound, 0);
-						}
-						
-						createLifeOrb(renderer, boss_position, this->curr_level.getLifeOrbPiece());
-						if (this->curr_level.getLifeOrbPiece() == 1) Mix_PlayChannel(-1, first_shard_avl, 0);
-						if (this->curr_level.getLifeOrbPiece() == 3) Mix_PlayChannel(-1, third_shard_avl, 0);
+					if (this->curr_level.getCurrLevel() == FINAL_BOSS) {
+						Mix_PlayChannel(-1, final_boss_death_sound, 0);
 					}
+					
+					createLifeOrb(renderer, boss_position, this->curr_level.getLifeOrbPiece());
+					if (this->curr_level.getLifeOrbPiece() == 1) Mix_PlayChannel(-1, first_shard_avl, 0);
+					if (this->curr_level.getLifeOrbPiece() == 3) Mix_PlayChannel(-1, third_shard_avl, 0);
 				}
 			}
 		}
+	}
 
-		// Checking Projectile - Player collisions
-		if (registry.players.has(entity_other) && registry.projectiles.has(entity) && registry.projectiles.get(entity).hostile) {
-			Mix_PlayChannel(-1, damage_tick_sound, 0);
-			Resources& player_resource = registry.resources.get(entity_other);
-			float damage_dealt = registry.projectiles.get(entity).damage; // any damage modifications should be performed on this value
-			/* TODO: Can the player be weak to any element?
-			if (isWeakTo(registry.players.get(entity_other).type, registry.projectiles.get(entity).type)) {
-				damage_dealt *= 2;
-			}*/
-			player_resource.currentHealth -= damage_dealt;
-			printf("Player hp: %f\n", player_resource.currentHealth);
-			if (player_resource.currentHealth <= 0) {
-				if (!registry.deathTimers.has(entity_other)) {
-					registry.deathTimers.emplace(entity_other);
-					registry.velocities.get(player).velocity = vec2(0.f, 0.f);
-					Mix_PlayChannel(-1, aria_death_sound, 0);
-					if (this->curr_level.getCurrLevel() != FINAL_BOSS && !this->curr_level.getIsBossLevel()) Mix_PlayChannel(-1, aria_death_lsvl, 0);
-				}
+	// Checking Projectile - Player collisions
+	if (began && registry.players.has(entity_other) && registry.projectiles.has(entity) && registry.projectiles.get(entity).hostile) {
+		Mix_PlayChannel(-1, damage_tick_sound, 0);
+		Resources& player_resource = registry.resources.get(entity_other);
+		float damage_dealt = registry.projectiles.get(entity).damage; // any damage modifications should be performed on this value
+		/* TODO: Can the player be weak to any element?
+		if (isWeakTo(registry.players.get(entity_other).type, registry.projectiles.get(entity).type)) {
+			damage_dealt *= 2;
+		}*/
+		player_resource.currentHealth -= damage_dealt;
+		printf("Player hp: %f\n", player_resource.currentHealth);
+		if (player_resource.currentHealth <= 0) {
+			if (!registry.deathTimers.has(entity_other)) {
+				registry.deathTimers.emplace(entity_other);
+				registry.velocities.get(player).velocity = vec2(0.f, 0.f);
+				Mix_PlayChannel(-1, aria_death_sound, 0);
+				if (this->curr_level.getCurrLevel() != FINAL_BOSS && !this->curr_level.getIsBossLevel()) Mix_PlayChannel(-1, aria_death_lsvl, 0);
 			}
-			registry.remove_all_components_of_no_collision(entity);
 		}
+		projectile_pool.release(entity);
+	}
 
-		// Checking Terrain - Projectile collisions
-		if (registry.terrain.has(entity_other) && registry.projectiles.has(entity)) {
-			Projectile& projectile = registry.projectiles.get(entity);
+	// Checking Terrain - Projectile collisions
+	if (began && registry.terrain.has(entity_other) && registry.projectiles.has(entity)) {
+		Projectile& projectile = registry.projectiles.get(entity);
 
-			if (projectile.bounces-- > 0) {
-				// bounce the projectile off the wall
-				Position& projectile_position = registry.positions.get(entity);
-				Velocity& projectile_velocity = registry.velocities.get(entity);
-				Position& terrain_position = registry.positions.get(entity_other);
+		if (projectile.bounces-- > 0) {
+			// bounce the projectile off the wall
+			Position& projectile_position = registry.positions.get(entity);
+			Velocity& projectile_velocity = registry.velocities.get(entity);
+			Position& terrain_position = registry.positions.get(entity_other);
 
-				if (collidedLeft(projectile_position, terrain_position) || collidedRight(projectile_position, terrain_position)) {
-					projectile_velocity.velocity.x *= -1;
-					projectile_position.angle = atan2(projectile_velocity.velocity.y, projectile_velocity.velocity.x);
-				}
-				else if (collidedTop(projectile_position, terrain_position) || collidedBottom(projectile_position, terrain_position)) {
-					projectile_velocity.velocity.y *= -1;
-					projectile_position.angle = atan2(projectile_velocity.velocity.y, projectile_velocity.velocity.x);
-				}
+			// swept collisions already know which face was hit
+			if (normal != vec2(0.f, 0.f)) {
+				if (normal.x != 0.f) projectile_velocity.velocity.x *= -1;
+				if (normal.y != 0.f) projectile_velocity.velocity.y *= -1;
+				projectile_position.angle = atan2(projectile_velocity.velocity.y, projectile_velocity.velocity.x);
 			}
-			else {
-				registry.remove_all_components_of_no_collision(entity);
+			else if (collidedLeft(projectile_position, terrain_position) || collidedRight(projectile_position, terrain_position)) {
+				projectile_velocity.velocity.x *= -1;
+				projectile_position.angle = atan2(projectile_velocity.velocity.y, projectile_velocity.velocity.x);
 			}
+			else if (collidedTop(projectile_position, terrain_position) || collidedBottom(projectile_position, terrain_position)) {
+				projectile_velocity.velocity.y *= -1;
+				projectile_position.angle = atan2(projectile_velocity.velocity.y, projectile_velocity.velocity.x);
+			}
+		}
+		else {
+			projectile_pool.release(entity);
 		}
+	}
 
-		// Checking Projectile - Power Up Block collisions
-		if (registry.powerUpBlocks.has(entity_other) && registry.projectiles.has(entity)) {
-			PowerUpBlock& powerUpBlock = registry.powerUpBlocks.get(entity_other);
-			Position& blockPos = registry.positions.get(entity_other);
+	// Checking Projectile - Power Up Block collisions
+	if (began && registry.powerUpBlocks.has(entity_other) && registry.projectiles.has(entity)) {
+		PowerUpBlock& powerUpBlock = registry.powerUpBlocks.get(entity_other);
+		Position& blockPos = registry.positions.get(entity_other);
 
-			// do nothing if this power up is already toggled on
-			if (*powerUpBlock.powerUpToggle) {
-				registry.remove_all_components_of_no_collision(entity); // remove projectile
-				continue;
-			}
+		// do nothing if this power up is already toggled on
+		if (*powerUpBlock.powerUpToggle) {
+			projectile_pool.release(entity); // remove projectile
+			return true;
+		}
 
-			// disable previously selected power up first
-			auto& powerUpBlocksRegistry = registry.powerUpBlocks;
-			for (uint j = 0; j < powerUpBlocksRegistry.entities.size(); j++) {
-				Entity pubEntity = powerUpBlocksRegistry.entities[j];
-				PowerUpBlock pub = powerUpBlocksRegistry.get(pubEntity);
+		// disable previously selected power up first
+		auto& powerUpBlocksRegistry = registry.powerUpBlocks;
+		for (uint j = 0; j < powerUpBlocksRegistry.entities.size(); j++) {
+			Entity pubEntity = powerUpBlocksRegistry.entities[j];
+			PowerUpBlock pub = powerUpBlocksRegistry.get(pubEntity);
 
-				if (!*pub.powerUpToggle) continue; // skip over curr power up block if its already disabled
+			if (!*pub.powerUpToggle) continue; // skip over curr power up block if its already disabled
 
-				Animation& animation = registry.animations.get(pubEntity);
-				animation.setState((int)POWER_UP_BLOCK_STATES::ACTIVE);
-				animation.is_animating = true;
-				animation.rainbow_enabled = true;
+			Animation& animation = registry.animations.get(pubEntity);
+			animation.setState((int)POWER_UP_BLOCK_STATES::ACTIVE);
+			animation.is_animating = true;
+			animation.rainbow_enabled = true;
 
-				*(pub.powerUpToggle) = false;
-				registry.remove_all_components_of(pub.textEntity);
-			}
+			*(pub.powerUpToggle) = false;
+			registry.remove_all_components_of(pub.textEntity);
+		}
 
-			Animation& animation = registry.animations.get(entity_other);
-			animation.setState((int)getPowerUpBlockStateFromString(powerUpBlock.powerUpText));
-			animation.is_animating = false;
-			animation.rainbow_enabled = false;
+		Animation& animation = registry.animations.get(entity_other);
+		animation.setState((int)getPowerUpBlockStateFromString(powerUpBlock.powerUpText));
+		animation.is_animating = false;
+		animation.rainbow_enabled = false;
 
-			// enable newly selected power up
-			*(powerUpBlock.powerUpToggle) = true;
-			powerUpBlock.textEntity = createText("You unlocked: " + powerUpBlock.powerUpText, vec2(0.f, 50.f), 1.f, vec3(0.f, 1.f, 0.f));
+		// enable newly selected power up
+		*(powerUpBlock.powerUpToggle) = true;
+		powerUpBlock.textEntity = createText("You unlocked: " + powerUpBlock.powerUpText, vec2(0.f, 50.f), 1.f, vec3(0.f, 1.f, 0.f));
 
-			Mix_PlayChannel(-1, power_up_sound, 0);
+		Mix_PlayChannel(-1, power_up_sound, 0);
 
-			registry.remove_all_components_of_no_collision(entity); // remove projectile
-		}
+		projectile_pool.release(entity); // remove projectile
+	}
 
-		// Checking Player - Exit Door collision
-		if (registry.players.has(entity) && registry.exitDoors.has(entity_other)) {
-			if (curr_level.getIsCutscene()) {
-				Mix_FadeInMusic(background_music, -1, 1500);
-				if (registry.lostSouls.size() > 0) registry.velocities.get(registry.lostSouls.entities[0]).velocity = vec2(0, 0);
-			}
-			win_level();
+	// Checking Player - Exit Door collision
+	if (began && registry.players.has(entity) && registry.exitDoors.has(entity_other)) {
+		if (curr_level.getIsCutscene()) {
+			Mix_FadeInMusic(background_music, -1, 1500);
+			if (registry.lostSouls.size() > 0) registry.velocities.get(registry.lostSouls.entities[0]).velocity = vec2(0, 0);
 		}
+		win_level();
+	}
 
-		// Checking Player - Medkit collision
-		if (registry.players.has(entity) && registry.healthPacks.has(entity_other)) {
-			Mix_PlayChannel(-1, heal_sound, 0);
-			Resources& player_resource = registry.resources.get(entity);
-			player_resource.currentHealth = std::min(player_resource.maxHealth, 
-				player_resource.currentHealth + registry.healthPacks.get(entity_other).value);
-			printf("Player hp: %f\n", player_resource.currentHealth);
-			registry.remove_all_components_of_no_collision(entity_other);
-		}
+	// Checking Player - Medkit collision
+	if (began && registry.players.has(entity) && registry.healthPacks.has(entity_other)) {
+		Mix_PlayChannel(-1, heal_sound, 0);
+		Resources& player_resource = registry.resources.get(entity);
+		player_resource.currentHealth = std::min(player_resource.maxHealth, 
+			player_resource.currentHealth + registry.healthPacks.get(entity_other).value);
+		printf("Player hp: %f\n", player_resource.currentHealth);
+		registry.remove_all_components_of(entity_other);
+	}
 
-		// Player - Life Orb collision
-		if (registry.players.has(entity) && registry.lifeOrbs.has(entity_other)) {
-			// play a sound??
-			registry.remove_all_components_of_no_collision(entity_other); 
-			win_level();
-		}
+	// Player - Life Orb collision
+	if (began && registry.players.has(entity) && registry.lifeOrbs.has(entity_other)) {
+		// play a sound??
+		registry.remove_all_components_of(entity_other); 
+		win_level();
+	}
 
-		// Checking Player - Lost Soul collision
-		if (registry.players.has(entity) && registry.lostSouls.has(entity_other)) {
-			if (this->curr_level.getCurrLevel() == CUTSCENE_1 ||
-				this->curr_level.getCurrLevel() == CUTSCENE_3 ||
-				this->curr_level.getCurrLevel() == CUTSCENE_4 ||
-				this->curr_level.getCurrLevel() == CUTSCENE_5) {
-				Velocity& lost_soul_velocity = registry.velocities.get(entity_other);
-				Velocity& player_velocity = registry.velocities.get(entity);
-				lost_soul_velocity.velocity = player_velocity.velocity;
-				animateLostSoul(entity_other);
-			}
+	// Checking Player - Lost Soul collision, the lost soul copies the player's movement while they touch
+	if (touching && registry.players.has(entity) && registry.lostSouls.has(entity_other)) {
+		if (this->curr_level.getCurrLevel() == CUTSCENE_1 ||
+			this->curr_level.getCurrLevel() == CUTSCENE_3 ||
+			this->curr_level.getCurrLevel() == CUTSCENE_4 ||
+			this->curr_level.getCurrLevel() == CUTSCENE_5) {
+			Velocity& lost_soul_velocity = registry.velocities.get(entity_other);
+			Velocity& player_velocity = registry.velocities.get(entity);
+			lost_soul_velocity.velocity = player_velocity.velocity;
+			animateLostSoul(entity_other);
 		}
-
 	}
-	registry.collisions.clear();
+
+	return true;
 }
 
 // Should the game be over ?
@@ -1479,6 +1548,10 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		else ui_system->setState(PAUSE_MENU);
 	}
 
+	// Render stats overlay and debug title
+	if (action == GLFW_RELEASE && key == GLFW_KEY_F3)
+		debugging.in_debug_mode = !debugging.in_debug_mode;
+
 	// Debugging
 	//if (key == GLFW_KEY_D) {
 	//	if (action == GLFW_RELEASE)
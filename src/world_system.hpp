@@ -5,7 +5,6 @@
 
 // stlib
 #include <vector>
-#include <random>
 
 #define SDL_MAIN_HANDLED
 #include <SDL.h>
@@ -13,6 +12,7 @@
 
 #include "render_system.hpp"
 #include "game_level.hpp"
+#include "contact_cache.hpp"
 
 // Container for all our entities and game logic. Individual rendering / update is
 // deferred to the relative update() methods
@@ -33,6 +33,9 @@ public:
 	// Steps the game ahead by ms milliseconds
 	bool step(float elapsed_ms);
 
+	// Refreshes the window title, called once per rendered frame rather than every tick
+	void update_title();
+
 	// Check for collisions
 	void handle_collisions();
 
@@ -40,6 +43,7 @@ public:
 	bool is_over()const;
 
 	void new_game();
+	void new_survival();
 	void win_level();
 	void display_power_up();
 	GameLevel getLevel() { return curr_level; }
@@ -53,12 +57,16 @@ private:
 	// restart game
 	void restart_game();
 
+	// React to a single contact transition reported by the physics system
+	bool handle_contact(CONTACT_PHASE phase, Entity entity, Entity entity_other, vec2 displacement, vec2 normal);
+
 	// OpenGL window handle
 	GLFWwindow* window;
 
 	// Game state
 	RenderSystem* renderer;
 	Entity player;
+	bool player_has_shadow = false;
 	Entity projectileSelectDisplay;
 
 	GameLevel curr_level;
@@ -105,8 +113,4 @@ private:
 	Mix_Chunk* deceived_avl;
 	Mix_Chunk* final_cutscene_avl;
 
-
-	// C++ random number generator
-	std::default_random_engine rng;
-	std::uniform_real_distribution<float> uniform_dist{0.7, 1}; // number between 0.7 ..1
 };
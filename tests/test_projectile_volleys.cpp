@@ -0,0 +1,72 @@
+// internal
+#include "projectile_volleys.hpp"
+#include "projectile_pool.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <cstdio>
+
+int failures = 0;
+
+#define CHECK(condition) \
+	if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); failures++; }
+
+// A projectile with the components the volley operations touch, as createProjectile leaves it
+Entity fire(float lifetime_ms)
+{
+	Entity entity = projectile_pool.acquire(lifetime_ms);
+	if (!registry.positions.has(entity)) registry.positions.emplace(entity);
+	registry.velocities.emplace(entity);
+	return entity;
+}
+
+// A member that hits a wall and is fired again into the same volley before the volley is used
+// must count once, the pool hands back the most recently freed entity
+void refiredMemberCountsOnce()
+{
+	uint volley = volleys.create();
+	Entity first = fire(1000.f);
+	Entity second = fire(1000.f);
+	volleys.add(volley, first);
+	volleys.add(volley, second);
+
+	projectile_pool.release(first);
+	projectile_pool.update(1.f);
+	Entity refired = fire(1000.f);
+	CHECK(refired == first);
+	volleys.add(volley, refired);
+
+	CHECK(volleys.size(volley) == 2);
+	volleys.set_velocity(volley, { 10.f, 0.f });
+	volleys.scale_speed(volley, 2.f);
+	CHECK(registry.velocities.get(refired).velocity == vec2(20.f, 0.f));
+	CHECK(registry.velocities.get(second).velocity == vec2(20.f, 0.f));
+
+	volleys.despawn(volley);
+	CHECK(projectile_pool.live_count() == 0);
+	CHECK(volleys.size(volley) == 0);
+}
+
+// Members released some other way drop out of the volley
+void releasedMemberLeaves()
+{
+	uint volley = volleys.create();
+	Entity first = fire(1000.f);
+	Entity second = fire(1000.f);
+	volleys.add(volley, first);
+	volleys.add(volley, second);
+
+	projectile_pool.release(second);
+	CHECK(volleys.size(volley) == 1);
+	volleys.set_velocity(volley, { 0.f, 5.f });
+	CHECK(registry.velocities.get(first).velocity == vec2(0.f, 5.f));
+	volleys.despawn(volley);
+}
+
+int main()
+{
+	refiredMemberCountsOnce();
+	releasedMemberLeaves();
+	if (failures == 0) printf("projectile volleys: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}